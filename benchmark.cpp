@@ -0,0 +1,250 @@
+// benchmark.cpp
+#include <bits/stdc++.h>
+#include <omp.h>
+#include <sys/wait.h>
+#include "dataset.h"
+#include "options.h"
+#include "synthetic.h"
+#include "topology.h"
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Projeto: Bancada de desempenho das versões do K-Means
+// Descrição: gera (uma vez, semente fixa) um .kmb com K nuvens gaussianas de
+// N pontos em D dimensões, mede a banda de memória com a tríade do STREAM e
+// roda cada executável (kmeans sequencial, open_mp_cpu com cada --algo e
+// openmp_gpu, que cai no host sem dispositivo) para cada número de threads.
+// Cada execução é repetida e vale o menor tempo da linha "→ N iterações em
+// X s" que os programas imprimem (sem leitura de arquivo e inicialização).
+//
+// Métricas por execução: tempo por iteração, pontos/s, GB/s lidos (N·D·8
+// bytes por passada de atribuição; nas variantes com poda é uma banda
+// "efetiva"), fração do STREAM com o mesmo número de threads, eficiência
+// paralela t1/(T·tT) e speedup sobre o sequencial do mesmo algoritmo. O
+// resultado vai em JSON para --out, para comparar versões com diff.
+//
+// Uso: ./benchmark [--n=200000] [--d=32] [--k=16] [--seed=42] [--iters=50]
+//        [--threads=1,2,4] [--algos=lloyd,hamerly,elkan,yinyang]
+//        [--backends=seq,omp,offload] [--reps=3] [--bin=.] [--out=bench.json]
+// -----------------------------------------------------------------------------
+
+// ─────────── CONFIGURAÇÃO ───────────────────────────────────────────────────────
+// STREAM_ELEMS: doubles por vetor da tríade (3 vetores; bem maior que o cache)
+// STREAM_REPS:  repetições da tríade (vale a melhor)
+// ────────────────────────────────────────────────────────────────────────────────
+#define STREAM_ELEMS (1 << 24)
+#define STREAM_REPS  5
+
+// Uma execução de um backend
+struct BenchRun {
+    string backend, algo;
+    int threads = 1;
+    bool ok = false;          // programa existe e imprimiu o tempo
+    int iterations = 0;
+    bool converged = false;
+    double secs = 0.0;        // menor tempo entre as repetições
+    double secs_per_iter = 0.0, points_per_s = 0.0, gbs = 0.0;
+    double stream_fraction = 0.0, efficiency = 0.0, speedup_vs_seq = 0.0;
+};
+
+static vector<string> split(const string& s) {
+    vector<string> out;
+    stringstream ss(s);
+    string part;
+    while (getline(ss, part, ',')) if (!part.empty()) out.push_back(part);
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// Tríade do STREAM (a = b + s·c) com T threads; devolve a melhor banda em GB/s
+// (2 leituras + 1 escrita de 8 bytes por elemento, como no STREAM original)
+static double stream_triad(int T) {
+    const long long n = STREAM_ELEMS;
+    Matrix<double> a(1, n, false), b(1, n, false), c(1, n, false);
+    double* pa = a.data(); double* pb = b.data(); double* pc = c.data();
+    #pragma omp parallel for schedule(static) num_threads(T)
+    for (long long i = 0; i < n; i++) { pa[i] = 0.0; pb[i] = 1.0; pc[i] = 2.0; }
+    double best = 0.0;
+    for (int r = 0; r < STREAM_REPS; r++) {
+        auto t0 = chrono::steady_clock::now();
+        #pragma omp parallel for schedule(static) num_threads(T)
+        for (long long i = 0; i < n; i++) pa[i] = pb[i] + 3.0 * pc[i];
+        double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        best = max(best, 3.0 * 8.0 * n / s / 1e9);
+    }
+    return best;
+}
+
+// -----------------------------------------------------------------------------
+// Roda um comando e lê "→ N iterações em X s" e "Converg..." da saída
+static bool run_backend(const string& cmd, int& iterations, bool& converged, double& secs) {
+    FILE* p = popen((cmd + " 2>&1").c_str(), "r");
+    if (!p) return false;
+    static const regex timing("→ ([0-9]+) iterações em ([0-9.eE+-]+) s");
+    bool found = false;
+    converged = false;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), p)) {
+        string line(buf);
+        smatch m;
+        if (regex_search(line, m, timing)) {
+            iterations = stoi(m[1]);
+            secs = stod(m[2]);
+            found = true;
+        }
+        if (line.rfind("Converg", 0) == 0) converged = true;
+    }
+    const int status = pclose(p);
+    return found && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool executable(const string& path) { return access(path.c_str(), X_OK) == 0; }
+
+// -----------------------------------------------------------------------------
+// Saída JSON (sem dependências; só números e nomes simples)
+static void write_json(ostream& os, const Options& opt, const string& data, int N, int D, int K,
+                       const Topology& topo, const map<int, double>& stream, const vector<BenchRun>& runs) {
+    os << setprecision(6);
+    os << "{\n  \"dataset\": {\"file\": \"" << data << "\", \"n\": " << N << ", \"d\": " << D
+       << ", \"k\": " << K << ", \"seed\": " << opt.get_int("seed", 42) << "},\n";
+    os << "  \"machine\": {\"cpus\": " << topo.cpus() << ", \"numa_nodes\": " << topo.nodes() << "},\n";
+    os << "  \"stream_gbs\": {";
+    bool first = true;
+    for (auto& [t, g] : stream) { os << (first ? "" : ", ") << "\"" << t << "\": " << g; first = false; }
+    os << "},\n  \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); i++) {
+        const BenchRun& r = runs[i];
+        os << "    {\"backend\": \"" << r.backend << "\", \"algo\": \"" << r.algo << "\", \"threads\": "
+           << r.threads << ", \"ok\": " << (r.ok ? "true" : "false");
+        if (r.ok) {
+            os << ", \"iterations\": " << r.iterations << ", \"converged\": " << (r.converged ? "true" : "false")
+               << ", \"secs\": " << r.secs << ", \"secs_per_iter\": " << r.secs_per_iter
+               << ", \"points_per_s\": " << r.points_per_s << ", \"gbs\": " << r.gbs
+               << ", \"stream_fraction\": " << r.stream_fraction << ", \"efficiency\": " << r.efficiency
+               << ", \"speedup_vs_seq\": " << r.speedup_vs_seq;
+        }
+        os << "}" << (i + 1 < runs.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    Options opt = parse_options(argc, argv);
+    const int N = opt.get_int("n", 200000);
+    const int D = opt.get_int("d", 32);
+    const int K = opt.get_int("k", 16);
+    const uint64_t seed = opt.get_int("seed", 42);
+    const int iters = opt.get_int("iters", 50);
+    const int reps = max(1, opt.get_int("reps", 3));
+    const string bin = opt.get("bin", ".");
+    const string out = opt.get("out", "bench.json");
+    const vector<string> algos = split(opt.get("algos", "lloyd,hamerly,elkan,yinyang"));
+    const vector<string> backends = split(opt.get("backends", "seq,omp,offload"));
+    vector<int> threads;
+    if (opt.has("threads")) {
+        for (const string& t : split(opt.get("threads", ""))) threads.push_back(stoi(t));
+    } else {
+        for (int t = 1; t < omp_get_num_procs(); t *= 2) threads.push_back(t);
+        threads.push_back(omp_get_num_procs());
+    }
+    if (N <= 0 || D <= 0 || K <= 0 || K > N || threads.empty()) {
+        cerr << "Parâmetros inválidos (n, d, k ou threads)" << endl;
+        return 1;
+    }
+
+    // Dataset sintético: gerado só se ainda não existir
+    const string data = opt.get("data", "blobs_" + to_string(N) + "x" + to_string(D) + "_k"
+                                        + to_string(K) + "_s" + to_string(seed) + ".kmb");
+    if (access(data.c_str(), R_OK) != 0) {
+        auto t0 = chrono::steady_clock::now();
+        Dataset ds = make_blobs(N, D, K, seed);
+        save_kmb(ds, data, true);
+        cout << "→ Gerei " << data << " em "
+             << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+    } else {
+        cout << "→ Usando " << data << " (já existe)" << endl;
+    }
+
+    Topology topo = read_topology();
+    map<int, double> stream;
+    for (int t : threads) {
+        stream[t] = stream_triad(t);
+        cout << "→ STREAM tríade, " << t << " threads: " << fixed << setprecision(2) << stream[t]
+             << " GB/s" << defaultfloat << endl;
+    }
+
+    // Lista de execuções: o sequencial só com 1 thread, o offload só com lloyd
+    vector<BenchRun> runs;
+    for (const string& be : backends) {
+        const string exe = bin + "/" + (be == "seq" ? "kmeans" : be == "omp" ? "open_mp_cpu" : "openmp_gpu");
+        if (be != "seq" && be != "omp" && be != "offload") {
+            cerr << "Backend inválido: " << be << " (use seq, omp ou offload)" << endl;
+            return 1;
+        }
+        for (const string& algo : algos) {
+            if (be == "offload" && algo != "lloyd") continue;
+            for (int t : threads) {
+                if (be == "seq" && t != threads.front()) continue;
+                BenchRun r;
+                r.backend = be;
+                r.algo = algo;
+                r.threads = be == "seq" ? 1 : t;
+                if (!executable(exe)) {
+                    cout << "→ " << exe << " não encontrado, pulando" << endl;
+                    runs.push_back(r);
+                    continue;
+                }
+                string cmd = "OMP_NUM_THREADS=" + to_string(r.threads) + " " + exe + " " + to_string(K)
+                           + " " + to_string(iters) + " " + data;
+                if (be == "omp") cmd += " --threads=" + to_string(r.threads);
+                if (be != "offload") cmd += " --algo=" + algo;
+                r.secs = numeric_limits<double>::infinity();
+                for (int rep = 0; rep < reps; rep++) {
+                    int it; bool conv; double s;
+                    if (!run_backend(cmd, it, conv, s)) { r.ok = false; break; }
+                    r.ok = true;
+                    r.iterations = it;
+                    r.converged = conv;
+                    r.secs = min(r.secs, s);
+                }
+                if (r.ok) {
+                    // Passadas de atribuição: a que detecta a convergência também conta
+                    const int passes = max(1, r.iterations + (r.converged ? 1 : 0));
+                    r.secs_per_iter = r.secs / passes;
+                    r.points_per_s = (double)N * passes / r.secs;
+                    r.gbs = (double)N * D * sizeof(double) * passes / r.secs / 1e9;
+                    const auto st = stream.find(r.threads);
+                    if (st != stream.end()) r.stream_fraction = r.gbs / st->second;
+                    cout << "→ " << be << "/" << algo << " " << r.threads << " threads: "
+                         << r.iterations << " iterações, " << r.secs_per_iter * 1e3 << " ms/iteração, "
+                         << scientific << setprecision(3) << r.points_per_s << " pontos/s" << defaultfloat
+                         << setprecision(6) << endl;
+                } else {
+                    cout << "→ " << be << "/" << algo << " " << r.threads << " threads: falhou" << endl;
+                }
+                runs.push_back(r);
+            }
+        }
+    }
+
+    // Eficiência (contra o mesmo backend/algoritmo com 1 thread) e speedup
+    // sobre o sequencial do mesmo algoritmo
+    for (BenchRun& r : runs) {
+        if (!r.ok) continue;
+        for (const BenchRun& b : runs) {
+            if (!b.ok || b.algo != r.algo) continue;
+            if (b.backend == r.backend && b.threads == 1)
+                r.efficiency = b.secs_per_iter / (r.threads * r.secs_per_iter);
+            if (b.backend == "seq") r.speedup_vs_seq = b.secs_per_iter / r.secs_per_iter;
+        }
+    }
+
+    ofstream js(out);
+    if (!js) {
+        cerr << "Erro ao criar " << out << endl;
+        return 1;
+    }
+    write_json(js, opt, data, N, D, K, topo, stream, runs);
+    cout << "→ Resultados em " << out << endl;
+    return 0;
+}
@@ -0,0 +1,136 @@
+// coreset.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "init.h"
+#include "kmeans_core.h"
+#include "ksweep.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// Coreset leve (--coreset=M): resumo ponderado dos dados para N muito grande.
+//
+// Cada ponto é sorteado com probabilidade
+//   q_i = α/N + (1 - α)·d²(x_i, μ)/Σ_j d²(x_j, μ)
+// (μ = média dos dados, α = CORESET_UNIFORM): metade uniforme, metade pela
+// distância à média, o que garante amostras das regiões afastadas onde ficam
+// os clusters pequenos. Cada um dos M sorteios vale 1/(M·q_i) pontos;
+// repetidos viram um ponto só com a soma dos pesos. O custo é uma passada
+// para a média e uma para d², O(N·D) no total, sem depender de K.
+//
+// O K-Means roda sobre os m <= M pontos ponderados: a atualização soma w·x e
+// w por centróide (somas em blocos de REDUCE_BLOCK, na ordem dos blocos, como
+// em CentroidSums), e os centróides iniciais vêm do K-Means++ ponderado.
+// -----------------------------------------------------------------------------
+
+#define CORESET_UNIFORM 0.5   // parte uniforme da distribuição de amostragem
+
+struct Coreset {
+    Matrix<double> P;          // m×D pontos distintos
+    std::vector<double> w;     // peso de cada ponto (a soma estima N)
+
+    int size() const { return static_cast<int>(P.rows()); }
+};
+
+// -----------------------------------------------------------------------------
+// build_coreset: M sorteios com reposição segundo q
+// -----------------------------------------------------------------------------
+inline Coreset build_coreset(const Matrix<double>& X, int N, int M, const DistanceKernel& kern,
+                             uint64_t seed) {
+    using sweep_detail::blocked_sum;
+    const int D = static_cast<int>(X.cols());
+    std::vector<double> mu = blocked_sum(N, D, [&](int lo, int hi, double* part) {
+        for (int i = lo; i < hi; i++) {
+            const double* x = X.row(i);
+            for (int d = 0; d < D; d++) part[d] += x[d];
+        }
+    });
+    for (double& v : mu) v /= N;
+    std::vector<double> q(N);
+    const double total = blocked_sum(N, 1, [&](int lo, int hi, double* part) {
+        for (int i = lo; i < hi; i++) {
+            q[i] = kern.sqdist(X.row(i), mu.data(), D);
+            part[0] += q[i];
+        }
+    })[0];
+
+    // q normalizado e sua acumulada; sorteios ordenados pelo índice
+    const double a = total > 0.0 ? CORESET_UNIFORM : 1.0;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < N; i++) q[i] = a / N + (total > 0.0 ? (1.0 - a) * q[i] / total : 0.0);
+    std::vector<double> cum(N);
+    std::partial_sum(q.begin(), q.end(), cum.begin());
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, cum.back());
+    std::vector<int> pick(M);
+    for (int j = 0; j < M; j++)
+        pick[j] = std::min(N - 1, static_cast<int>(std::upper_bound(cum.begin(), cum.end(), u(rng)) - cum.begin()));
+    std::sort(pick.begin(), pick.end());
+
+    Coreset cs;
+    std::vector<int> idx;
+    for (int j = 0; j < M; j++) {
+        if (j == 0 || pick[j] != pick[j - 1]) {
+            idx.push_back(pick[j]);
+            cs.w.push_back(0.0);
+        }
+        cs.w.back() += 1.0 / (static_cast<double>(M) * q[pick[j]]);
+    }
+    cs.P.reset(idx.size(), D);
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < static_cast<int>(idx.size()); j++) std::copy_n(X.row(idx[j]), D, cs.P.row(j));
+    return cs;
+}
+
+// -----------------------------------------------------------------------------
+// kmeans_weighted: Lloyd sobre o coreset; cada centróide vira a média
+// ponderada dos seus pontos
+// -----------------------------------------------------------------------------
+inline KMeansResult kmeans_weighted(const Coreset& cs, Matrix<double> C, int max_iter,
+                                    const DistanceKernel& kern) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    const int m = cs.size();
+    const int W = K * (D + 1) + 1;   // por centróide: Σw·x e Σw; no fim, rótulos mudados
+    KMeansResult res;
+    res.labels.assign(m, -1);
+    int* labels = res.labels.data();
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        std::vector<double> s = sweep_detail::blocked_sum(m, W, [&](int lo, int hi, double* part) {
+            for (int i = lo; i < hi; i++) {
+                const double* x = cs.P.row(i);
+                double best;
+                const int k = kern.nearest(x, C.data(), C.stride(), K, D, &best);
+                if (labels[i] != k) {
+                    labels[i] = k;
+                    part[W - 1] += 1.0;
+                }
+                double* pk = part + static_cast<size_t>(k) * (D + 1);
+                const double wi = cs.w[i];
+                for (int d = 0; d < D; d++) pk[d] += wi * x[d];
+                pk[D] += wi;
+            }
+        });
+        if (s[W - 1] == 0.0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+        for (int k = 0; k < K; k++) {
+            const double* sk = &s[static_cast<size_t>(k) * (D + 1)];
+            if (sk[D] <= 0.0) continue;   // sem pontos, fica onde estava
+            for (int d = 0; d < D; d++) C(k, d) = sk[d] / sk[D];
+        }
+    }
+    res.centroids = std::move(C);
+    return res;
+}
+
+// Centróides iniciais: K-Means++ ponderado sobre o coreset
+inline Matrix<double> coreset_init(const Coreset& cs, int K, const DistanceKernel& kern, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    Matrix<double> C(K, cs.P.cols());
+    init_detail::weighted_kmeanspp(cs.P, cs.w, K, kern, rng, C);
+    return C;
+}
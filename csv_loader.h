@@ -0,0 +1,211 @@
+// csv_loader.h
+#pragma once
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "matrix.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Carregador de CSV compartilhado por todas as versões do K-Means.
+// O arquivo é mapeado em memória (mmap), dividido em blocos alinhados a '\n'
+// e cada bloco é convertido em paralelo com std::from_chars diretamente para
+// uma única Matrix N×D alinhada (linha a linha). Mantém o comportamento antigo:
+// header opcional ignorado, espaços/CR/vírgulas finais descartados, tokens não
+// numéricos ignorados e a última coluna (rótulo) separada dos dados.
+// Sem -fopenmp o mesmo código roda em uma thread só.
+// -----------------------------------------------------------------------------
+
+struct CsvData {
+    int N = 0;                   // número de amostras
+    int D = 0;                   // dimensão (sem a coluna de rótulo)
+    Matrix<double> values;       // N×D, row-major com passo alinhado
+    std::vector<double> labels;  // N valores da coluna removida (rótulo)
+};
+
+namespace csv_detail {
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+// Fim "útil" da linha [b, e): remove CR/LF e vírgulas finais
+inline const char* trim_line_end(const char* b, const char* e) {
+    while (e > b && (e[-1] == '\r' || e[-1] == '\n' || e[-1] == ',')) e--;
+    return e;
+}
+
+// Converte uma linha. Escreve até D valores em out (se out != nullptr), o
+// valor seguinte em *label (se label != nullptr) e retorna quantos tokens
+// numéricos foram encontrados.
+inline int parse_line(const char* b, const char* e, double* out, int D, double* label = nullptr) {
+    int n = 0;
+    while (b <= e) {
+        const char* c = static_cast<const char*>(memchr(b, ',', e - b));
+        const char* cell_end = c ? c : e;
+        const char* s = b;
+        const char* t = cell_end;
+        while (s < t && is_blank(*s)) s++;
+        while (t > s && is_blank(t[-1])) t--;
+        if (s < t && *s == '+') s++;  // from_chars não aceita '+', stod aceitava
+        double v;
+        auto res = std::from_chars(s, t, v);
+        if (res.ec == std::errc()) {
+            if (out && n < D) out[n] = v;
+            else if (label && n == D) *label = v;
+            n++;
+        }
+        if (!c) break;
+        b = c + 1;
+    }
+    return n;
+}
+
+inline bool has_content(const char* b, const char* e) {
+    return trim_line_end(b, e) > b;
+}
+
+}  // namespace csv_detail
+
+// -----------------------------------------------------------------------------
+// load_csv: lê um CSV numérico para um buffer contíguo.
+// Parâmetros:
+//  filename    - caminho do CSV
+//  skip_header - se true, ignora a primeira linha
+// Linhas cujo número de colunas difere da primeira linha de dados são
+// descartadas (com aviso), para manter a matriz retangular.
+// -----------------------------------------------------------------------------
+inline CsvData load_csv(const std::string& filename, bool skip_header) {
+    using namespace csv_detail;
+    CsvData out;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Erro ao abrir arquivo: " << filename << std::endl;
+        exit(1);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        close(fd);
+        if (skip_header) {
+            std::cerr << "Arquivo vazio ou sem header para pular" << std::endl;
+            exit(1);
+        }
+        return out;
+    }
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Erro no mmap de " << filename << std::endl;
+        exit(1);
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    const char* base = static_cast<const char*>(map);
+    const char* end = base + size;
+
+    const char* p = base;
+    if (skip_header) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = nl ? nl + 1 : end;
+    }
+
+    // Descobre D a partir da primeira linha com conteúdo
+    const char* first = p;
+    while (first < end) {
+        const char* nl = static_cast<const char*>(memchr(first, '\n', end - first));
+        const char* le = nl ? nl : end;
+        const char* te = trim_line_end(first, le);
+        if (te > first && parse_line(first, te, nullptr, 0) > 1) break;
+        first = nl ? nl + 1 : end;
+    }
+    if (first >= end) {
+        munmap(map, size);
+        return out;
+    }
+    {
+        const char* nl = static_cast<const char*>(memchr(first, '\n', end - first));
+        out.D = parse_line(first, trim_line_end(first, nl ? nl : end), nullptr, 0) - 1;
+    }
+    const int D = out.D;
+
+    // Divide [first, end) em blocos que começam sempre no início de uma linha
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    size_t span = static_cast<size_t>(end - first);
+    int nchunks = static_cast<int>(std::min<size_t>(std::max(1, nthreads * 4), std::max<size_t>(1, span / (1 << 16))));
+    std::vector<const char*> bounds(nchunks + 1);
+    bounds[0] = first;
+    bounds[nchunks] = end;
+    for (int c = 1; c < nchunks; c++) {
+        const char* q = first + span * c / nchunks;
+        if (q < bounds[c - 1]) q = bounds[c - 1];
+        const char* nl = static_cast<const char*>(memchr(q, '\n', end - q));
+        bounds[c] = nl ? nl + 1 : end;
+    }
+
+    // Passo 1: conta linhas com conteúdo por bloco
+    std::vector<size_t> rows(nchunks + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < nchunks; c++) {
+        size_t cnt = 0;
+        for (const char* q = bounds[c]; q < bounds[c + 1]; ) {
+            const char* nl = static_cast<const char*>(memchr(q, '\n', bounds[c + 1] - q));
+            const char* le = nl ? nl : bounds[c + 1];
+            if (has_content(q, le)) cnt++;
+            q = le + 1;
+        }
+        rows[c + 1] = cnt;
+    }
+    for (int c = 0; c < nchunks; c++) rows[c + 1] += rows[c];
+
+    // Passo 2: converte direto na posição final de cada linha
+    size_t total = rows[nchunks];
+    out.values.reset(total, D);
+    out.labels.resize(total);
+    std::vector<char> valid(total, 1);
+    size_t bad = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:bad)
+    for (int c = 0; c < nchunks; c++) {
+        size_t r = rows[c];
+        for (const char* q = bounds[c]; q < bounds[c + 1]; ) {
+            const char* nl = static_cast<const char*>(memchr(q, '\n', bounds[c + 1] - q));
+            const char* le = nl ? nl : bounds[c + 1];
+            const char* te = trim_line_end(q, le);
+            if (te > q) {
+                // D valores + 1 rótulo
+                if (parse_line(q, te, out.values.row(r), D, &out.labels[r]) != D + 1) {
+                    valid[r] = 0;
+                    bad++;
+                }
+                r++;
+            }
+            q = le + 1;
+        }
+    }
+    munmap(map, size);
+
+    // Compacta (raro) removendo linhas malformadas
+    if (bad > 0) {
+        std::cerr << "Aviso: " << bad << " linhas ignoradas (número de colunas diferente de "
+                  << D + 1 << ")" << std::endl;
+        Matrix<double> kept(total - bad, D);
+        size_t w = 0;
+        for (size_t r = 0; r < total; r++) {
+            if (!valid[r]) continue;
+            std::copy_n(out.values.row(r), D, kept.row(w));
+            out.labels[w] = out.labels[r];
+            w++;
+        }
+        total = w;
+        out.values = std::move(kept);
+        out.labels.resize(total);
+    }
+    out.N = static_cast<int>(total);
+    return out;
+}
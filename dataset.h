@@ -0,0 +1,230 @@
+// dataset.h
+#pragma once
+#include <bits/stdc++.h>
+#include "csv_loader.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// Formato binário de cache do dataset (.kmb) e carregamento unificado.
+//
+// Layout do arquivo:
+//   [0, 64)               KmbHeader
+//   [data_offset, ...)    N linhas row-major, cada uma com `stride` valores
+//                         (alinhado a 64 bytes; o writer usa o mesmo passo
+//                         com padding da Matrix, então a visão mapeada tem o
+//                         layout idêntico ao da memória)
+//   [labels_offset, ...)  N rótulos em double (opcional, alinhado a 64 bytes)
+//
+// O arquivo é gerado uma vez com o modo `convert` e depois aberto com mmap:
+// o K-Means roda direto sobre a memória mapeada, sem cópia nem parsing.
+// -----------------------------------------------------------------------------
+
+#define KMB_MAGIC    "KMEANSB"
+#define KMB_VERSION  1
+#define KMB_ALIGN    64
+
+enum KmbDtype : uint32_t { KMB_F64 = 1 };
+
+struct KmbHeader {
+    char     magic[8];       // "KMEANSB\0"
+    uint32_t version;        // KMB_VERSION
+    uint32_t dtype;          // KmbDtype
+    uint64_t n;              // número de amostras
+    uint64_t d;              // dimensão
+    uint64_t stride;         // valores por linha no payload (>= d)
+    uint64_t data_offset;    // início do payload (múltiplo de KMB_ALIGN)
+    uint64_t labels_offset;  // início dos rótulos, 0 se ausentes
+    uint64_t checksum;       // FNV-1a 64 sobre payload + rótulos
+};
+static_assert(sizeof(KmbHeader) == KMB_ALIGN, "KmbHeader deve ocupar 64 bytes");
+
+inline uint64_t kmb_align(uint64_t x) { return (x + KMB_ALIGN - 1) / KMB_ALIGN * KMB_ALIGN; }
+
+// FNV-1a por palavras de 64 bits (o tamanho é sempre múltiplo de 8)
+inline uint64_t kmb_checksum(const void* p, size_t bytes, uint64_t h = 1469598103934665603ULL) {
+    const uint64_t* w = static_cast<const uint64_t*>(p);
+    for (size_t i = 0; i < bytes / 8; i++) {
+        h ^= w[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Cabeçalho coerente com um arquivo de `size` bytes. Os blocos são comparados
+// com o espaço que sobra depois do deslocamento, por divisão, para que um
+// cabeçalho forjado não estoure n·stride e passe no teste de tamanho
+inline bool kmb_header_valid(const KmbHeader& h, uint64_t size) {
+    if (memcmp(h.magic, KMB_MAGIC, sizeof(KMB_MAGIC)) != 0 || h.version != KMB_VERSION || h.dtype != KMB_F64)
+        return false;
+    if (h.d == 0 || h.stride < h.d || h.n > INT_MAX || h.d > INT_MAX) return false;
+    if (h.data_offset < sizeof(KmbHeader) || h.data_offset % KMB_ALIGN != 0 || h.data_offset > size)
+        return false;
+    if (h.n > (size - h.data_offset) / sizeof(double) / h.stride) return false;
+    return h.labels_offset == 0
+        || (h.labels_offset >= sizeof(KmbHeader) && h.labels_offset <= size
+            && h.n <= (size - h.labels_offset) / sizeof(double));
+}
+
+// -----------------------------------------------------------------------------
+// Dataset: N amostras de dimensão D em uma Matrix<double>.
+// A matriz é dona dos dados (CSV) ou uma visão sobre o arquivo mapeado
+// (.kmb); em ambos os casos row(i) aponta para a linha i.
+// -----------------------------------------------------------------------------
+struct Dataset {
+    int N = 0;
+    int D = 0;
+    Matrix<double> X;                // N×D
+    const double* labels = nullptr;  // N rótulos (ou nullptr)
+
+    std::vector<double> owned_labels;  // rótulos quando vieram de CSV
+    void* map = nullptr;               // região mapeada quando veio de .kmb
+    size_t map_size = 0;
+
+    Dataset() = default;
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+    Dataset(Dataset&& o) noexcept { *this = std::move(o); }
+    Dataset& operator=(Dataset&& o) noexcept {
+        std::swap(N, o.N); std::swap(D, o.D);
+        X.swap(o.X); std::swap(labels, o.labels);
+        std::swap(owned_labels, o.owned_labels);
+        std::swap(map, o.map); std::swap(map_size, o.map_size);
+        return *this;
+    }
+    ~Dataset() { if (map) munmap(map, map_size); }
+
+    const double* row(size_t i) const { return X.row(i); }
+    size_t stride() const { return X.stride(); }
+    bool mapped() const { return map != nullptr; }
+};
+
+inline bool is_kmb_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    return in && memcmp(magic, KMB_MAGIC, sizeof(KMB_MAGIC)) == 0;
+}
+
+// -----------------------------------------------------------------------------
+// load_kmb: abre um .kmb com mmap (zero cópia). Se verify for true, recalcula
+// o checksum (lê o arquivo inteiro, então é opcional).
+// -----------------------------------------------------------------------------
+inline Dataset load_kmb(const std::string& filename, bool verify) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Erro ao abrir arquivo: " << filename << std::endl;
+        exit(1);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = size >= sizeof(KmbHeader) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Erro no mmap de " << filename << std::endl;
+        exit(1);
+    }
+    const KmbHeader* h = static_cast<const KmbHeader*>(map);
+    if (!kmb_header_valid(*h, size)) {
+        std::cerr << "Arquivo binário inválido ou incompatível: " << filename << std::endl;
+        munmap(map, size);
+        exit(1);
+    }
+    const char* base = static_cast<const char*>(map);
+    const uint64_t payload = h->n * h->stride * sizeof(double);
+    if (verify) {
+        uint64_t sum = kmb_checksum(base + h->data_offset, payload);
+        if (h->labels_offset) sum = kmb_checksum(base + h->labels_offset, h->n * sizeof(double), sum);
+        if (sum != h->checksum) {
+            std::cerr << "Checksum não confere em " << filename << std::endl;
+            munmap(map, size);
+            exit(1);
+        }
+    }
+
+    Dataset ds;
+    ds.N = static_cast<int>(h->n);
+    ds.D = static_cast<int>(h->d);
+    // Visão somente-leitura: a Matrix não escreve nem libera a região mapeada
+    ds.X = Matrix<double>(reinterpret_cast<double*>(const_cast<char*>(base) + h->data_offset),
+                          h->n, h->d, h->stride);
+    ds.labels = h->labels_offset ? reinterpret_cast<const double*>(base + h->labels_offset) : nullptr;
+    ds.map = map;
+    ds.map_size = size;
+    return ds;
+}
+
+// -----------------------------------------------------------------------------
+// load_dataset: decide pelo conteúdo (magic) entre .kmb mapeado e CSV.
+// -----------------------------------------------------------------------------
+inline Dataset load_dataset(const std::string& filename, bool skip_header, bool verify = false) {
+    if (is_kmb_file(filename)) return load_kmb(filename, verify);
+    CsvData csv = load_csv(filename, skip_header);
+    Dataset ds;
+    ds.N = csv.N;
+    ds.D = csv.D;
+    ds.X = std::move(csv.values);
+    ds.owned_labels = std::move(csv.labels);
+    ds.labels = ds.owned_labels.empty() ? nullptr : ds.owned_labels.data();
+    return ds;
+}
+
+// -----------------------------------------------------------------------------
+// save_kmb: grava um Dataset no formato binário.
+// -----------------------------------------------------------------------------
+inline void save_kmb(const Dataset& ds, const std::string& filename, bool with_labels) {
+    KmbHeader h{};
+    memcpy(h.magic, KMB_MAGIC, sizeof(KMB_MAGIC));
+    h.version = KMB_VERSION;
+    h.dtype = KMB_F64;
+    h.n = ds.N;
+    h.d = ds.D;
+    h.stride = ds.stride();
+    h.data_offset = KMB_ALIGN;
+    uint64_t payload = h.n * h.stride * sizeof(double);
+    with_labels = with_labels && ds.labels;
+    h.labels_offset = with_labels ? kmb_align(h.data_offset + payload) : 0;
+    h.checksum = kmb_checksum(ds.X.data(), payload);
+    if (with_labels) h.checksum = kmb_checksum(ds.labels, h.n * sizeof(double), h.checksum);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Erro ao criar arquivo: " << filename << std::endl;
+        exit(1);
+    }
+    static const char zeros[KMB_ALIGN] = {};
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(ds.X.data()), payload);
+    if (with_labels) {
+        out.write(zeros, h.labels_offset - (h.data_offset + payload));
+        out.write(reinterpret_cast<const char*>(ds.labels), h.n * sizeof(double));
+    }
+    if (!out) {
+        std::cerr << "Erro ao gravar " << filename << std::endl;
+        exit(1);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// convert_main: modo `convert <entrada.csv> <saida.kmb> [--no-labels]`,
+// disponível em todos os executáveis.
+// -----------------------------------------------------------------------------
+inline int convert_main(int argc, char* argv[], bool skip_header) {
+    if (argc < 4) {
+        std::cerr << "Uso: " << argv[0] << " convert <entrada.csv> <saida.kmb> [--no-labels]" << std::endl;
+        return 1;
+    }
+    bool with_labels = !(argc >= 5 && std::string(argv[4]) == "--no-labels");
+    auto t0 = std::chrono::steady_clock::now();
+    Dataset ds = load_dataset(argv[2], skip_header);
+    if (ds.N == 0) {
+        std::cerr << "Nenhuma amostra carregada de " << argv[2] << std::endl;
+        return 1;
+    }
+    save_kmb(ds, argv[3], with_labels);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "→ Converti " << ds.N << " amostras (dim=" << ds.D << ") de " << argv[2]
+              << " para " << argv[3] << (with_labels && ds.labels ? " com rótulos" : "")
+              << " em " << secs << " s" << std::endl;
+    return 0;
+}
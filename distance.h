@@ -0,0 +1,462 @@
+// distance.h
+#pragma once
+#include <bits/stdc++.h>
+#include <immintrin.h>
+
+// -----------------------------------------------------------------------------
+// Kernels de distância Euclidiana ao quadrado.
+//
+// Só o argmin interessa no K-Means, então nenhum kernel calcula sqrt.
+// Há três implementações, escolhidas em tempo de execução pela CPU:
+//   scalar  - referência e fallback (laço simples, o compilador vetoriza o
+//             que conseguir com o ISA base)
+//   avx2    - 4 doubles por registrador, FMA
+//   avx512  - 8 doubles por registrador, cauda com load mascarado
+// Cada uma é instanciada para dimensões comuns (DIM > 0, laço totalmente
+// desenrolado; ex.: covtype D=54) e para D genérico (DIM = 0).
+// nearest() compara o ponto com 4 centróides por passada: o ponto é lido uma
+// vez por bloco de 8 (ou 4) dimensões e reaproveitado nos 4 acumuladores.
+//
+// A variável de ambiente KMEANS_KERNEL=scalar|avx2|avx512 força a escolha.
+//
+// Os kernels existem em double e em float (DistanceKernelT<float>, usado por
+// --precision=f32): em float cabem o dobro de valores por registrador e a
+// leitura dos pontos cai pela metade; a soma é feita em float.
+// -----------------------------------------------------------------------------
+
+template <typename T>
+struct DistanceKernelT {
+    std::string name;  // ex.: "avx512/D=54"
+    // Distância ao quadrado entre dois vetores de dimensão D
+    T (*sqdist)(const T* a, const T* b, int D);
+    // Índice do centróide mais próximo de x entre as K linhas de C (passo cs);
+    // grava a distância ao quadrado em *best
+    int (*nearest)(const T* x, const T* C, size_t cs, int K, int D, T* best);
+};
+
+using DistanceKernel = DistanceKernelT<double>;
+using SqDistFn = decltype(DistanceKernel::sqdist);
+using NearestFn = decltype(DistanceKernel::nearest);
+
+namespace dist_detail {
+
+// ─────────── scalar ───────────
+template <int DIM, typename T = double>
+inline T sqdist_scalar(const T* a, const T* b, int Drt) {
+    const int D = DIM ? DIM : Drt;
+    T sum = 0;
+    for (int i = 0; i < D; i++) {
+        T diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+template <int DIM, typename T = double>
+inline int nearest_scalar(const T* x, const T* C, size_t cs, int K, int D, T* best_out) {
+    T best = std::numeric_limits<T>::infinity();
+    int who = 0;
+    for (int k = 0; k < K; k++) {
+        T d = sqdist_scalar<DIM, T>(x, C + k * cs, D);
+        if (d < best) { best = d; who = k; }
+    }
+    if (best_out) *best_out = best;
+    return who;
+}
+
+// ─────────── AVX2 ───────────
+__attribute__((target("avx2,fma")))
+inline double hsum256(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256i tail_mask256(int rem) {
+    // rem em [1, 3]: habilita as primeiras `rem` lanes
+    return _mm256_setr_epi64x(rem > 0 ? -1 : 0, rem > 1 ? -1 : 0, rem > 2 ? -1 : 0, 0);
+}
+
+template <int DIM>
+__attribute__((target("avx2,fma")))
+double sqdist_avx2(const double* a, const double* b, int Drt) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 4 * 4;
+    __m256d acc = _mm256_setzero_pd();
+    for (int i = 0; i < full; i += 4) {
+        __m256d t = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        acc = _mm256_fmadd_pd(t, t, acc);
+    }
+    if (full < D) {
+        __m256i m = tail_mask256(D - full);
+        __m256d t = _mm256_sub_pd(_mm256_maskload_pd(a + full, m), _mm256_maskload_pd(b + full, m));
+        acc = _mm256_fmadd_pd(t, t, acc);
+    }
+    return hsum256(acc);
+}
+
+template <int DIM>
+__attribute__((target("avx2,fma")))
+int nearest_avx2(const double* x, const double* C, size_t cs, int K, int Drt, double* best_out) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 4 * 4;
+    const __m256i m = tail_mask256(D - full);
+    double best = std::numeric_limits<double>::infinity();
+    int who = 0;
+    int k = 0;
+    for (; k + 4 <= K; k += 4) {
+        const double* c0 = C + (k + 0) * cs;
+        const double* c1 = C + (k + 1) * cs;
+        const double* c2 = C + (k + 2) * cs;
+        const double* c3 = C + (k + 3) * cs;
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        for (int i = 0; i < full; i += 4) {
+            __m256d xv = _mm256_loadu_pd(x + i);
+            __m256d t0 = _mm256_sub_pd(xv, _mm256_loadu_pd(c0 + i));
+            __m256d t1 = _mm256_sub_pd(xv, _mm256_loadu_pd(c1 + i));
+            __m256d t2 = _mm256_sub_pd(xv, _mm256_loadu_pd(c2 + i));
+            __m256d t3 = _mm256_sub_pd(xv, _mm256_loadu_pd(c3 + i));
+            a0 = _mm256_fmadd_pd(t0, t0, a0);
+            a1 = _mm256_fmadd_pd(t1, t1, a1);
+            a2 = _mm256_fmadd_pd(t2, t2, a2);
+            a3 = _mm256_fmadd_pd(t3, t3, a3);
+        }
+        if (full < D) {
+            __m256d xv = _mm256_maskload_pd(x + full, m);
+            __m256d t0 = _mm256_sub_pd(xv, _mm256_maskload_pd(c0 + full, m));
+            __m256d t1 = _mm256_sub_pd(xv, _mm256_maskload_pd(c1 + full, m));
+            __m256d t2 = _mm256_sub_pd(xv, _mm256_maskload_pd(c2 + full, m));
+            __m256d t3 = _mm256_sub_pd(xv, _mm256_maskload_pd(c3 + full, m));
+            a0 = _mm256_fmadd_pd(t0, t0, a0);
+            a1 = _mm256_fmadd_pd(t1, t1, a1);
+            a2 = _mm256_fmadd_pd(t2, t2, a2);
+            a3 = _mm256_fmadd_pd(t3, t3, a3);
+        }
+        double d[4] = { hsum256(a0), hsum256(a1), hsum256(a2), hsum256(a3) };
+        for (int j = 0; j < 4; j++)
+            if (d[j] < best) { best = d[j]; who = k + j; }
+    }
+    for (; k < K; k++) {
+        double d = sqdist_avx2<DIM>(x, C + k * cs, D);
+        if (d < best) { best = d; who = k; }
+    }
+    if (best_out) *best_out = best;
+    return who;
+}
+
+// ─────────── AVX-512 ───────────
+// (soma horizontal com extract mascarado: _mm512_reduce_add_pd e o cast para
+// 256 bits geram avisos espúrios de -Wuninitialized no GCC 12)
+__attribute__((target("avx512f,avx2,fma")))
+inline double hsum512(__m512d v) {
+    __m256d lo = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, v, 0);
+    __m256d hi = _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, v, 1);
+    return hsum256(_mm256_add_pd(lo, hi));
+}
+
+template <int DIM>
+__attribute__((target("avx512f,avx2,fma")))
+double sqdist_avx512(const double* a, const double* b, int Drt) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 8 * 8;
+    __m512d acc = _mm512_setzero_pd();
+    for (int i = 0; i < full; i += 8) {
+        __m512d t = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        acc = _mm512_fmadd_pd(t, t, acc);
+    }
+    if (full < D) {
+        const __mmask8 m = static_cast<__mmask8>((1u << (D - full)) - 1);
+        __m512d t = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + full), _mm512_maskz_loadu_pd(m, b + full));
+        acc = _mm512_fmadd_pd(t, t, acc);
+    }
+    return hsum512(acc);
+}
+
+template <int DIM>
+__attribute__((target("avx512f,avx2,fma")))
+int nearest_avx512(const double* x, const double* C, size_t cs, int K, int Drt, double* best_out) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 8 * 8;
+    const __mmask8 m = static_cast<__mmask8>((1u << (D - full)) - 1);
+    double best = std::numeric_limits<double>::infinity();
+    int who = 0;
+    int k = 0;
+    for (; k + 4 <= K; k += 4) {
+        const double* c0 = C + (k + 0) * cs;
+        const double* c1 = C + (k + 1) * cs;
+        const double* c2 = C + (k + 2) * cs;
+        const double* c3 = C + (k + 3) * cs;
+        __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+        __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+        for (int i = 0; i < full; i += 8) {
+            __m512d xv = _mm512_loadu_pd(x + i);
+            __m512d t0 = _mm512_sub_pd(xv, _mm512_loadu_pd(c0 + i));
+            __m512d t1 = _mm512_sub_pd(xv, _mm512_loadu_pd(c1 + i));
+            __m512d t2 = _mm512_sub_pd(xv, _mm512_loadu_pd(c2 + i));
+            __m512d t3 = _mm512_sub_pd(xv, _mm512_loadu_pd(c3 + i));
+            a0 = _mm512_fmadd_pd(t0, t0, a0);
+            a1 = _mm512_fmadd_pd(t1, t1, a1);
+            a2 = _mm512_fmadd_pd(t2, t2, a2);
+            a3 = _mm512_fmadd_pd(t3, t3, a3);
+        }
+        if (full < D) {
+            __m512d xv = _mm512_maskz_loadu_pd(m, x + full);
+            __m512d t0 = _mm512_sub_pd(xv, _mm512_maskz_loadu_pd(m, c0 + full));
+            __m512d t1 = _mm512_sub_pd(xv, _mm512_maskz_loadu_pd(m, c1 + full));
+            __m512d t2 = _mm512_sub_pd(xv, _mm512_maskz_loadu_pd(m, c2 + full));
+            __m512d t3 = _mm512_sub_pd(xv, _mm512_maskz_loadu_pd(m, c3 + full));
+            a0 = _mm512_fmadd_pd(t0, t0, a0);
+            a1 = _mm512_fmadd_pd(t1, t1, a1);
+            a2 = _mm512_fmadd_pd(t2, t2, a2);
+            a3 = _mm512_fmadd_pd(t3, t3, a3);
+        }
+        double d[4] = { hsum512(a0), hsum512(a1), hsum512(a2), hsum512(a3) };
+        for (int j = 0; j < 4; j++)
+            if (d[j] < best) { best = d[j]; who = k + j; }
+    }
+    for (; k < K; k++) {
+        double d = sqdist_avx512<DIM>(x, C + k * cs, D);
+        if (d < best) { best = d; who = k; }
+    }
+    if (best_out) *best_out = best;
+    return who;
+}
+
+// ─────────── float (AVX2: 8 por registrador, AVX-512: 16) ───────────
+__attribute__((target("avx2,fma")))
+inline float hsum256_ps(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256i tail_mask256_ps(int rem) {
+    // rem em [1, 7]: habilita as primeiras `rem` lanes de 32 bits
+    alignas(32) static const int32_t bits[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + 8 - rem));
+}
+
+template <int DIM>
+__attribute__((target("avx2,fma")))
+float sqdist_avx2_f(const float* a, const float* b, int Drt) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 8 * 8;
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < full; i += 8) {
+        __m256 t = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc = _mm256_fmadd_ps(t, t, acc);
+    }
+    if (full < D) {
+        __m256i m = tail_mask256_ps(D - full);
+        __m256 t = _mm256_sub_ps(_mm256_maskload_ps(a + full, m), _mm256_maskload_ps(b + full, m));
+        acc = _mm256_fmadd_ps(t, t, acc);
+    }
+    return hsum256_ps(acc);
+}
+
+template <int DIM>
+__attribute__((target("avx2,fma")))
+int nearest_avx2_f(const float* x, const float* C, size_t cs, int K, int Drt, float* best_out) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 8 * 8;
+    const __m256i m = tail_mask256_ps(full < D ? D - full : 8);
+    float best = std::numeric_limits<float>::infinity();
+    int who = 0;
+    int k = 0;
+    for (; k + 4 <= K; k += 4) {
+        const float* c0 = C + (k + 0) * cs;
+        const float* c1 = C + (k + 1) * cs;
+        const float* c2 = C + (k + 2) * cs;
+        const float* c3 = C + (k + 3) * cs;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (int i = 0; i < full; i += 8) {
+            __m256 xv = _mm256_loadu_ps(x + i);
+            __m256 t0 = _mm256_sub_ps(xv, _mm256_loadu_ps(c0 + i));
+            __m256 t1 = _mm256_sub_ps(xv, _mm256_loadu_ps(c1 + i));
+            __m256 t2 = _mm256_sub_ps(xv, _mm256_loadu_ps(c2 + i));
+            __m256 t3 = _mm256_sub_ps(xv, _mm256_loadu_ps(c3 + i));
+            a0 = _mm256_fmadd_ps(t0, t0, a0);
+            a1 = _mm256_fmadd_ps(t1, t1, a1);
+            a2 = _mm256_fmadd_ps(t2, t2, a2);
+            a3 = _mm256_fmadd_ps(t3, t3, a3);
+        }
+        if (full < D) {
+            __m256 xv = _mm256_maskload_ps(x + full, m);
+            __m256 t0 = _mm256_sub_ps(xv, _mm256_maskload_ps(c0 + full, m));
+            __m256 t1 = _mm256_sub_ps(xv, _mm256_maskload_ps(c1 + full, m));
+            __m256 t2 = _mm256_sub_ps(xv, _mm256_maskload_ps(c2 + full, m));
+            __m256 t3 = _mm256_sub_ps(xv, _mm256_maskload_ps(c3 + full, m));
+            a0 = _mm256_fmadd_ps(t0, t0, a0);
+            a1 = _mm256_fmadd_ps(t1, t1, a1);
+            a2 = _mm256_fmadd_ps(t2, t2, a2);
+            a3 = _mm256_fmadd_ps(t3, t3, a3);
+        }
+        float d[4] = { hsum256_ps(a0), hsum256_ps(a1), hsum256_ps(a2), hsum256_ps(a3) };
+        for (int j = 0; j < 4; j++)
+            if (d[j] < best) { best = d[j]; who = k + j; }
+    }
+    for (; k < K; k++) {
+        float d = sqdist_avx2_f<DIM>(x, C + k * cs, D);
+        if (d < best) { best = d; who = k; }
+    }
+    if (best_out) *best_out = best;
+    return who;
+}
+
+// Mesma soma horizontal do hsum512, reinterpretando os 512 bits como double
+// para extrair as metades só com AVX-512F
+__attribute__((target("avx512f,avx2,fma")))
+inline float hsum512_ps(__m512 v) {
+    __m512d vd = _mm512_castps_pd(v);
+    __m256 lo = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vd, 0));
+    __m256 hi = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vd, 1));
+    return hsum256_ps(_mm256_add_ps(lo, hi));
+}
+
+template <int DIM>
+__attribute__((target("avx512f,avx2,fma")))
+float sqdist_avx512_f(const float* a, const float* b, int Drt) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 16 * 16;
+    __m512 acc = _mm512_setzero_ps();
+    for (int i = 0; i < full; i += 16) {
+        __m512 t = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc = _mm512_fmadd_ps(t, t, acc);
+    }
+    if (full < D) {
+        const __mmask16 m = static_cast<__mmask16>((1u << (D - full)) - 1);
+        __m512 t = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + full), _mm512_maskz_loadu_ps(m, b + full));
+        acc = _mm512_fmadd_ps(t, t, acc);
+    }
+    return hsum512_ps(acc);
+}
+
+template <int DIM>
+__attribute__((target("avx512f,avx2,fma")))
+int nearest_avx512_f(const float* x, const float* C, size_t cs, int K, int Drt, float* best_out) {
+    const int D = DIM ? DIM : Drt;
+    const int full = D / 16 * 16;
+    const __mmask16 m = static_cast<__mmask16>((1u << (D - full)) - 1);
+    float best = std::numeric_limits<float>::infinity();
+    int who = 0;
+    int k = 0;
+    for (; k + 4 <= K; k += 4) {
+        const float* c0 = C + (k + 0) * cs;
+        const float* c1 = C + (k + 1) * cs;
+        const float* c2 = C + (k + 2) * cs;
+        const float* c3 = C + (k + 3) * cs;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+        __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (int i = 0; i < full; i += 16) {
+            __m512 xv = _mm512_loadu_ps(x + i);
+            __m512 t0 = _mm512_sub_ps(xv, _mm512_loadu_ps(c0 + i));
+            __m512 t1 = _mm512_sub_ps(xv, _mm512_loadu_ps(c1 + i));
+            __m512 t2 = _mm512_sub_ps(xv, _mm512_loadu_ps(c2 + i));
+            __m512 t3 = _mm512_sub_ps(xv, _mm512_loadu_ps(c3 + i));
+            a0 = _mm512_fmadd_ps(t0, t0, a0);
+            a1 = _mm512_fmadd_ps(t1, t1, a1);
+            a2 = _mm512_fmadd_ps(t2, t2, a2);
+            a3 = _mm512_fmadd_ps(t3, t3, a3);
+        }
+        if (full < D) {
+            __m512 xv = _mm512_maskz_loadu_ps(m, x + full);
+            __m512 t0 = _mm512_sub_ps(xv, _mm512_maskz_loadu_ps(m, c0 + full));
+            __m512 t1 = _mm512_sub_ps(xv, _mm512_maskz_loadu_ps(m, c1 + full));
+            __m512 t2 = _mm512_sub_ps(xv, _mm512_maskz_loadu_ps(m, c2 + full));
+            __m512 t3 = _mm512_sub_ps(xv, _mm512_maskz_loadu_ps(m, c3 + full));
+            a0 = _mm512_fmadd_ps(t0, t0, a0);
+            a1 = _mm512_fmadd_ps(t1, t1, a1);
+            a2 = _mm512_fmadd_ps(t2, t2, a2);
+            a3 = _mm512_fmadd_ps(t3, t3, a3);
+        }
+        float d[4] = { hsum512_ps(a0), hsum512_ps(a1), hsum512_ps(a2), hsum512_ps(a3) };
+        for (int j = 0; j < 4; j++)
+            if (d[j] < best) { best = d[j]; who = k + j; }
+    }
+    for (; k < K; k++) {
+        float d = sqdist_avx512_f<DIM>(x, C + k * cs, D);
+        if (d < best) { best = d; who = k; }
+    }
+    if (best_out) *best_out = best;
+    return who;
+}
+
+// ─────────── tabela de instâncias ───────────
+enum class Isa { Scalar, Avx2, Avx512 };
+
+template <int DIM, typename T>
+DistanceKernelT<T> make_kernel(Isa isa) {
+    if constexpr (std::is_same<T, float>::value) {
+        switch (isa) {
+        case Isa::Avx512: return { "avx512", sqdist_avx512_f<DIM>, nearest_avx512_f<DIM> };
+        case Isa::Avx2:   return { "avx2", sqdist_avx2_f<DIM>, nearest_avx2_f<DIM> };
+        default:          return { "scalar", sqdist_scalar<DIM, float>, nearest_scalar<DIM, float> };
+        }
+    } else {
+        switch (isa) {
+        case Isa::Avx512: return { "avx512", sqdist_avx512<DIM>, nearest_avx512<DIM> };
+        case Isa::Avx2:   return { "avx2", sqdist_avx2<DIM>, nearest_avx2<DIM> };
+        default:          return { "scalar", sqdist_scalar<DIM>, nearest_scalar<DIM> };
+        }
+    }
+}
+
+// Dimensões com instância desenrolada (54 = covtype sem rótulo)
+template <typename T>
+DistanceKernelT<T> kernel_for_dim(Isa isa, int D, bool& specialized) {
+    specialized = true;
+    switch (D) {
+    case 2:  return make_kernel<2, T>(isa);
+    case 3:  return make_kernel<3, T>(isa);
+    case 4:  return make_kernel<4, T>(isa);
+    case 8:  return make_kernel<8, T>(isa);
+    case 16: return make_kernel<16, T>(isa);
+    case 32: return make_kernel<32, T>(isa);
+    case 54: return make_kernel<54, T>(isa);
+    case 64: return make_kernel<64, T>(isa);
+    default:
+        specialized = false;
+        return make_kernel<0, T>(isa);
+    }
+}
+
+inline Isa detect_isa() {
+    const char* env = getenv("KMEANS_KERNEL");
+    if (env) {
+        std::string s(env);
+        if (s == "scalar") return Isa::Scalar;
+        if (s == "avx2") return Isa::Avx2;
+        if (s == "avx512") return Isa::Avx512;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::Avx2;
+    return Isa::Scalar;
+}
+
+}  // namespace dist_detail
+
+// -----------------------------------------------------------------------------
+// select_kernel: escolhe ISA (pela CPU ou KMEANS_KERNEL) e instância para D
+// (select_kernel<float> para os kernels em precisão simples).
+// -----------------------------------------------------------------------------
+template <typename T = double>
+DistanceKernelT<T> select_kernel(int D) {
+    using namespace dist_detail;
+    Isa isa = detect_isa();
+    // Não confia no ambiente se a CPU não suportar o ISA pedido
+    __builtin_cpu_init();
+    if (isa == Isa::Avx512 && !__builtin_cpu_supports("avx512f")) isa = Isa::Scalar;
+    if (isa == Isa::Avx2 && !(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))) isa = Isa::Scalar;
+    bool specialized;
+    DistanceKernelT<T> k = kernel_for_dim<T>(isa, D, specialized);
+    k.name += specialized ? "/D=" + std::to_string(D) : "/D genérico";
+    if (std::is_same<T, float>::value) k.name += "/f32";
+    return k;
+}
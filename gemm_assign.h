@@ -0,0 +1,219 @@
+// gemm_assign.h
+#pragma once
+#include <bits/stdc++.h>
+#include <immintrin.h>
+#include "matrix.h"
+#include "distance.h"
+
+// -----------------------------------------------------------------------------
+// Atribuição em lote no estilo GEMM, para K grande (centenas a milhares).
+//
+// Usa ||x - c||² = ||x||² - 2 x·c + ||c||². Como ||x||² não muda o argmin,
+// basta minimizar ||c||² - 2 x·c; ||x||² (pré-calculado uma vez) só entra
+// para devolver a distância real.
+//
+// Os produtos x·c são calculados como um GEMM em blocos:
+//   - os centróides são empacotados por iteração em painéis de GEMM_NR
+//     centróides, layout [d][GEMM_NR] (um vetor AVX-512 por dimensão);
+//   - os pontos são percorridos em blocos de GEMM_MB linhas (cabem na L1/L2);
+//     cada painel (D×GEMM_NR, poucos KB) é carregado uma vez por bloco e
+//     reaproveitado, já na L1, para todos os pontos do bloco;
+//   - o micro-kernel calcula GEMM_MR×GEMM_NR produtos em registradores e o
+//     argmin é feito na hora sobre esse ladrilho (nenhuma matriz N×K existe).
+// -----------------------------------------------------------------------------
+
+#define GEMM_MR  8     // pontos por micro-kernel
+#define GEMM_NR  8     // centróides por painel
+#define GEMM_MB  64    // pontos por bloco
+
+namespace gemm_detail {
+
+// out[p*GEMM_NR + j] = x_p · c_j para os GEMM_MR pontos e GEMM_NR centróides do painel
+using MicroFn = void (*)(const double* const* x, const double* panel, int D, double* out);
+
+inline void micro_scalar(const double* const* x, const double* panel, int D, double* out) {
+    double acc[GEMM_MR][GEMM_NR] = {};
+    for (int d = 0; d < D; d++) {
+        const double* pc = panel + d * GEMM_NR;
+        for (int p = 0; p < GEMM_MR; p++) {
+            double xv = x[p][d];
+            for (int j = 0; j < GEMM_NR; j++) acc[p][j] += xv * pc[j];
+        }
+    }
+    for (int p = 0; p < GEMM_MR; p++)
+        for (int j = 0; j < GEMM_NR; j++) out[p * GEMM_NR + j] = acc[p][j];
+}
+
+// AVX2: 4 pontos × 8 centróides por vez (8 acumuladores de 256 bits)
+__attribute__((target("avx2,fma")))
+inline void micro_avx2_4(const double* const* x, const double* panel, int D, double* out) {
+    __m256d a0l = _mm256_setzero_pd(), a0h = _mm256_setzero_pd();
+    __m256d a1l = _mm256_setzero_pd(), a1h = _mm256_setzero_pd();
+    __m256d a2l = _mm256_setzero_pd(), a2h = _mm256_setzero_pd();
+    __m256d a3l = _mm256_setzero_pd(), a3h = _mm256_setzero_pd();
+    const double *x0 = x[0], *x1 = x[1], *x2 = x[2], *x3 = x[3];
+    for (int d = 0; d < D; d++) {
+        __m256d cl = _mm256_load_pd(panel + d * GEMM_NR);
+        __m256d ch = _mm256_load_pd(panel + d * GEMM_NR + 4);
+        __m256d b;
+        b = _mm256_broadcast_sd(x0 + d); a0l = _mm256_fmadd_pd(b, cl, a0l); a0h = _mm256_fmadd_pd(b, ch, a0h);
+        b = _mm256_broadcast_sd(x1 + d); a1l = _mm256_fmadd_pd(b, cl, a1l); a1h = _mm256_fmadd_pd(b, ch, a1h);
+        b = _mm256_broadcast_sd(x2 + d); a2l = _mm256_fmadd_pd(b, cl, a2l); a2h = _mm256_fmadd_pd(b, ch, a2h);
+        b = _mm256_broadcast_sd(x3 + d); a3l = _mm256_fmadd_pd(b, cl, a3l); a3h = _mm256_fmadd_pd(b, ch, a3h);
+    }
+    _mm256_storeu_pd(out + 0,  a0l); _mm256_storeu_pd(out + 4,  a0h);
+    _mm256_storeu_pd(out + 8,  a1l); _mm256_storeu_pd(out + 12, a1h);
+    _mm256_storeu_pd(out + 16, a2l); _mm256_storeu_pd(out + 20, a2h);
+    _mm256_storeu_pd(out + 24, a3l); _mm256_storeu_pd(out + 28, a3h);
+}
+
+__attribute__((target("avx2,fma")))
+inline void micro_avx2(const double* const* x, const double* panel, int D, double* out) {
+    micro_avx2_4(x, panel, D, out);
+    micro_avx2_4(x + 4, panel, D, out + 4 * GEMM_NR);
+}
+
+// AVX-512: 8 pontos × 8 centróides, 8 acumuladores independentes (esconde a
+// latência do FMA nas duas portas)
+__attribute__((target("avx512f,avx2,fma")))
+inline void micro_avx512(const double* const* x, const double* panel, int D, double* out) {
+    __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+    __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+    __m512d a4 = _mm512_setzero_pd(), a5 = _mm512_setzero_pd();
+    __m512d a6 = _mm512_setzero_pd(), a7 = _mm512_setzero_pd();
+    const double *x0 = x[0], *x1 = x[1], *x2 = x[2], *x3 = x[3];
+    const double *x4 = x[4], *x5 = x[5], *x6 = x[6], *x7 = x[7];
+    for (int d = 0; d < D; d++) {
+        __m512d c = _mm512_load_pd(panel + d * GEMM_NR);
+        a0 = _mm512_fmadd_pd(_mm512_set1_pd(x0[d]), c, a0);
+        a1 = _mm512_fmadd_pd(_mm512_set1_pd(x1[d]), c, a1);
+        a2 = _mm512_fmadd_pd(_mm512_set1_pd(x2[d]), c, a2);
+        a3 = _mm512_fmadd_pd(_mm512_set1_pd(x3[d]), c, a3);
+        a4 = _mm512_fmadd_pd(_mm512_set1_pd(x4[d]), c, a4);
+        a5 = _mm512_fmadd_pd(_mm512_set1_pd(x5[d]), c, a5);
+        a6 = _mm512_fmadd_pd(_mm512_set1_pd(x6[d]), c, a6);
+        a7 = _mm512_fmadd_pd(_mm512_set1_pd(x7[d]), c, a7);
+    }
+    _mm512_storeu_pd(out + 0,  a0);
+    _mm512_storeu_pd(out + 8,  a1);
+    _mm512_storeu_pd(out + 16, a2);
+    _mm512_storeu_pd(out + 24, a3);
+    _mm512_storeu_pd(out + 32, a4);
+    _mm512_storeu_pd(out + 40, a5);
+    _mm512_storeu_pd(out + 48, a6);
+    _mm512_storeu_pd(out + 56, a7);
+}
+
+inline MicroFn select_micro(std::string& name) {
+    switch (dist_detail::detect_isa()) {
+    case dist_detail::Isa::Avx512:
+        if (__builtin_cpu_supports("avx512f")) { name = "avx512"; return micro_avx512; }
+        break;
+    case dist_detail::Isa::Avx2:
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { name = "avx2"; return micro_avx2; }
+        break;
+    default:
+        break;
+    }
+    name = "scalar";
+    return micro_scalar;
+}
+
+}  // namespace gemm_detail
+
+// -----------------------------------------------------------------------------
+// GemmAssigner: guarda ||x||² dos pontos e os painéis empacotados dos
+// centróides; assign() faz a etapa de atribuição completa em paralelo.
+// -----------------------------------------------------------------------------
+class GemmAssigner {
+public:
+    GemmAssigner(const Matrix<double>& X, int N, int D) : X_(X), N_(N), D_(D), xnorm_(N) {
+        micro_ = gemm_detail::select_micro(name_);
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < N; i++) {
+            const double* x = X.row(i);
+            double s = 0.0;
+            for (int d = 0; d < D; d++) s += x[d] * x[d];
+            xnorm_[i] = s;
+        }
+    }
+
+    const std::string& name() const { return name_; }
+
+    // Atribui cada ponto ao centróide mais próximo. Atualiza labels e, se
+    // dist != nullptr, grava a distância ao quadrado. Retorna quantos rótulos
+    // mudaram.
+    long long assign(const Matrix<double>& C, int K, std::vector<int>& labels, double* dist = nullptr) {
+        pack(C, K);
+        const int D = D_;
+        const int npanels = npanels_;
+        const int nblocks = (N_ + GEMM_MB - 1) / GEMM_MB;
+        long long changed = 0;
+
+        #pragma omp parallel for schedule(static) reduction(+:changed)
+        for (int b = 0; b < nblocks; b++) {
+            const int i0 = b * GEMM_MB;
+            const int i1 = std::min(N_, i0 + GEMM_MB);
+            double best[GEMM_MB];
+            int who[GEMM_MB];
+            std::fill(best, best + GEMM_MB, std::numeric_limits<double>::infinity());
+            std::fill(who, who + GEMM_MB, 0);
+            alignas(64) double tile[GEMM_MR * GEMM_NR];
+
+            for (int p = 0; p < npanels; p++) {
+                const double* panel = packed_.row(p);
+                const double* cn = cnorm_.data() + (size_t)p * GEMM_NR;
+                for (int i = i0; i < i1; i += GEMM_MR) {
+                    // Linhas que sobram no fim do bloco repetem o último ponto
+                    const double* xr[GEMM_MR];
+                    for (int r = 0; r < GEMM_MR; r++) xr[r] = X_.row(std::min(i + r, i1 - 1));
+                    micro_(xr, panel, D, tile);
+                    // argmin fundido sobre o ladrilho GEMM_MR×GEMM_NR
+                    for (int r = 0; r < GEMM_MR && i + r < i1; r++) {
+                        const int li = i + r - i0;
+                        for (int j = 0; j < GEMM_NR; j++) {
+                            double v = cn[j] - 2.0 * tile[r * GEMM_NR + j];
+                            if (v < best[li]) { best[li] = v; who[li] = p * GEMM_NR + j; }
+                        }
+                    }
+                }
+            }
+            for (int i = i0; i < i1; i++) {
+                const int li = i - i0;
+                if (dist) dist[i] = std::max(0.0, xnorm_[i] + best[li]);
+                if (labels[i] != who[li]) { labels[i] = who[li]; changed++; }
+            }
+        }
+        return changed;
+    }
+
+private:
+    // Empacota os centróides em painéis [d][GEMM_NR] e calcula ||c||².
+    // Centróides de preenchimento (k >= K) ficam com norma +inf.
+    void pack(const Matrix<double>& C, int K) {
+        const int D = D_;
+        npanels_ = (K + GEMM_NR - 1) / GEMM_NR;
+        if ((int)packed_.rows() != npanels_) packed_.reset(npanels_, (size_t)D * GEMM_NR);
+        else packed_.zero();
+        cnorm_.assign((size_t)npanels_ * GEMM_NR, std::numeric_limits<double>::infinity());
+        for (int k = 0; k < K; k++) {
+            const double* c = C.row(k);
+            double* dst = packed_.row(k / GEMM_NR) + k % GEMM_NR;
+            double s = 0.0;
+            for (int d = 0; d < D; d++) {
+                dst[d * GEMM_NR] = c[d];
+                s += c[d] * c[d];
+            }
+            cnorm_[k] = s;
+        }
+    }
+
+    const Matrix<double>& X_;
+    int N_, D_;
+    std::vector<double> xnorm_;
+    Matrix<double> packed_;  // um painel [d][GEMM_NR] por linha (alinhada a 64 bytes)
+    std::vector<double> cnorm_;
+    int npanels_ = 0;
+    gemm_detail::MicroFn micro_;
+    std::string name_;
+};
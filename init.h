@@ -0,0 +1,288 @@
+// init.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Inicialização dos centróides.
+//
+//  - random:   K amostras distintas sorteadas (init_indices, o padrão antigo);
+//  - kmeans++: variante gulosa (Arthur & Vassilvitskii): a cada passo sorteia
+//              2 + ln K candidatos com probabilidade ∝ D² e fica com o que
+//              mais reduz o custo;
+//  - kmeans||: Bahmani et al.: KMPAR_ROUNDS rodadas em que cada ponto entra
+//              com probabilidade ℓ·D²/custo (ℓ = KMPAR_OVERSAMPLE·K), depois
+//              os candidatos, pesados pelo número de pontos mais próximos,
+//              são reagrupados em K com kmeans++ e Lloyd ponderados.
+//
+// Os pontos são divididos em T faixas contíguas fixas (T = número de threads),
+// percorridas com omp for: se o runtime entregar menos threads (aninhamento,
+// OMP_DYNAMIC), cada uma pega mais de uma faixa e nenhuma fica de fora. Cada
+// faixa usa seu próprio gerador (semente derivada de seed, faixa e passo) e
+// as somas parciais são combinadas na ordem das faixas. Para a mesma semente
+// e o mesmo número de threads o resultado é sempre o mesmo.
+// -----------------------------------------------------------------------------
+
+#define KMPAR_ROUNDS      5    // rodadas de sobreamostragem do kmeans||
+#define KMPAR_OVERSAMPLE  2    // ℓ = KMPAR_OVERSAMPLE·K pontos esperados por rodada
+#define KMPAR_LLOYD_ITERS 10   // iterações de Lloyd ponderado sobre os candidatos
+
+namespace init_detail {
+
+inline int num_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Gerador da faixa t no passo step
+inline std::mt19937_64 stream(uint64_t seed, int t, uint64_t step) {
+    std::seed_seq seq{seed, static_cast<uint64_t>(t), step};
+    return std::mt19937_64(seq);
+}
+
+// Pontos [lo, hi) da faixa t entre T
+inline void range(int N, int T, int t, int& lo, int& hi) {
+    lo = static_cast<int>((long long)N * t / T);
+    hi = static_cast<int>((long long)N * (t + 1) / T);
+}
+
+// d2[i] = min(d2[i], ||x_i - c||²); devolve a soma (parciais na ordem das faixas)
+inline double relax(const Matrix<double>& X, int N, const double* c, const DistanceKernel& kern,
+                    std::vector<double>& d2, int T) {
+    const int D = static_cast<int>(X.cols());
+    std::vector<double> part(T, 0.0);
+    #pragma omp parallel for schedule(static) num_threads(T)
+    for (int t = 0; t < T; t++) {
+        int lo, hi;
+        range(N, T, t, lo, hi);
+        double s = 0.0;
+        for (int i = lo; i < hi; i++) {
+            d2[i] = std::min(d2[i], kern.sqdist(X.row(i), c, D));
+            s += d2[i];
+        }
+        part[t] = s;
+    }
+    return std::accumulate(part.begin(), part.end(), 0.0);
+}
+
+// Sorteia L índices com probabilidade ∝ d2: cada faixa sorteia L candidatos
+// com o próprio gerador; depois, para cada um dos L, a faixa é
+// escolhida ∝ à sua soma com o gerador principal.
+inline std::vector<int> sample_d2(const std::vector<double>& d2, int N, int L, int T,
+                                  uint64_t seed, uint64_t step, std::mt19937_64& rng) {
+    std::vector<double> wsum(T, 0.0);
+    std::vector<int> local((size_t)T * L, -1);
+    #pragma omp parallel for schedule(static) num_threads(T)
+    for (int t = 0; t < T; t++) {
+        int lo, hi;
+        range(N, T, t, lo, hi);
+        double s = 0.0;
+        for (int i = lo; i < hi; i++) s += d2[i];
+        wsum[t] = s;
+        std::mt19937_64 g = stream(seed, t, step);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        for (int l = 0; l < L && s > 0.0; l++) {
+            double r = u(g) * s;
+            int i = lo;
+            for (; i < hi - 1; i++) {
+                r -= d2[i];
+                if (r < 0.0) break;
+            }
+            local[(size_t)t * L + l] = i;
+        }
+    }
+    std::vector<int> out;
+    if (std::accumulate(wsum.begin(), wsum.end(), 0.0) <= 0.0) return out;
+    std::discrete_distribution<int> pick_thread(wsum.begin(), wsum.end());
+    for (int l = 0; l < L; l++) out.push_back(local[(size_t)pick_thread(rng) * L + l]);
+    return out;
+}
+
+// K-Means++ guloso sobre os n pontos de P com pesos w (usado pelo kmeans||)
+inline void weighted_kmeanspp(const Matrix<double>& P, const std::vector<double>& w, int K,
+                              const DistanceKernel& kern, std::mt19937_64& rng, Matrix<double>& C) {
+    const int n = static_cast<int>(P.rows());
+    const int D = static_cast<int>(P.cols());
+    const int L = 2 + static_cast<int>(std::log(K));
+    std::vector<double> d2(n, std::numeric_limits<double>::infinity()), wd(n), best_d2(n), tmp(n);
+    std::discrete_distribution<int> first(w.begin(), w.end());
+    std::copy_n(P.row(first(rng)), D, C.row(0));
+    for (int i = 0; i < n; i++) d2[i] = kern.sqdist(P.row(i), C.row(0), D);
+    for (int k = 1; k < K; k++) {
+        for (int i = 0; i < n; i++) wd[i] = w[i] * d2[i];
+        if (std::accumulate(wd.begin(), wd.end(), 0.0) <= 0.0) std::fill(wd.begin(), wd.end(), 1.0);
+        double best_cost = std::numeric_limits<double>::infinity();
+        int best = -1;
+        std::discrete_distribution<int> pick(wd.begin(), wd.end());
+        for (int l = 0; l < L; l++) {
+            const int c = pick(rng);
+            double cost = 0.0;
+            for (int i = 0; i < n; i++) {
+                tmp[i] = std::min(d2[i], kern.sqdist(P.row(i), P.row(c), D));
+                cost += w[i] * tmp[i];
+            }
+            if (cost < best_cost) { best_cost = cost; best = c; best_d2.swap(tmp); }
+        }
+        std::copy_n(P.row(best), D, C.row(k));
+        d2.swap(best_d2);
+    }
+}
+
+}  // namespace init_detail
+
+// -----------------------------------------------------------------------------
+// init_kmeanspp: K-Means++ guloso com amostragem D² em paralelo.
+// -----------------------------------------------------------------------------
+inline Matrix<double> init_kmeanspp(const Matrix<double>& X, int N, int K, const DistanceKernel& kern,
+                                    uint64_t seed) {
+    using namespace init_detail;
+    const int D = static_cast<int>(X.cols());
+    const int T = num_threads();
+    const int L = 2 + static_cast<int>(std::log(K));   // candidatos por passo
+    std::mt19937_64 rng(seed);
+    Matrix<double> C(K, D);
+
+    std::uniform_int_distribution<int> pick(0, N - 1);
+    std::copy_n(X.row(pick(rng)), D, C.row(0));
+    std::vector<double> d2(N, std::numeric_limits<double>::infinity());
+    relax(X, N, C.row(0), kern, d2, T);
+
+    std::vector<double> trial(N), best_d2(N);
+    for (int k = 1; k < K; k++) {
+        std::vector<int> cand = sample_d2(d2, N, L, T, seed, k, rng);
+        if (cand.empty()) cand.push_back(pick(rng));   // todos os pontos já são centróides
+        // Fica com o candidato que deixa o menor custo total
+        double best_cost = std::numeric_limits<double>::infinity();
+        int best = cand[0];
+        for (int c : cand) {
+            trial = d2;
+            double cost = relax(X, N, X.row(c), kern, trial, T);
+            if (cost < best_cost) { best_cost = cost; best = c; best_d2.swap(trial); }
+        }
+        std::copy_n(X.row(best), D, C.row(k));
+        d2.swap(best_d2);
+    }
+    return C;
+}
+
+// -----------------------------------------------------------------------------
+// init_kmeans_parallel: K-Means|| (sobreamostragem + reagrupamento ponderado).
+// -----------------------------------------------------------------------------
+inline Matrix<double> init_kmeans_parallel(const Matrix<double>& X, int N, int K, const DistanceKernel& kern,
+                                           uint64_t seed) {
+    using namespace init_detail;
+    const int D = static_cast<int>(X.cols());
+    const int T = num_threads();
+    const double ell = static_cast<double>(KMPAR_OVERSAMPLE) * K;
+    std::mt19937_64 rng(seed);
+
+    std::vector<int> cand;
+    std::uniform_int_distribution<int> pick(0, N - 1);
+    cand.push_back(pick(rng));
+    std::vector<double> d2(N, std::numeric_limits<double>::infinity());
+    double cost = relax(X, N, X.row(cand[0]), kern, d2, T);
+
+    for (int r = 0; r < KMPAR_ROUNDS && cost > 0.0; r++) {
+        // Cada ponto entra com probabilidade min(1, ℓ·d²/custo)
+        std::vector<std::vector<int>> chosen(T);
+        #pragma omp parallel for schedule(static) num_threads(T)
+        for (int t = 0; t < T; t++) {
+            int lo, hi;
+            range(N, T, t, lo, hi);
+            std::mt19937_64 g = stream(seed, t, 1000003ULL + r);
+            std::uniform_real_distribution<double> u(0.0, 1.0);
+            for (int i = lo; i < hi; i++)
+                if (u(g) < ell * d2[i] / cost) chosen[t].push_back(i);
+        }
+        const size_t before = cand.size();
+        for (int t = 0; t < T; t++) cand.insert(cand.end(), chosen[t].begin(), chosen[t].end());
+        // Atualiza d² com os novos candidatos
+        std::vector<double> part(T, 0.0);
+        #pragma omp parallel for schedule(static) num_threads(T)
+        for (int t = 0; t < T; t++) {
+            int lo, hi;
+            range(N, T, t, lo, hi);
+            double s = 0.0;
+            for (int i = lo; i < hi; i++) {
+                for (size_t j = before; j < cand.size(); j++)
+                    d2[i] = std::min(d2[i], kern.sqdist(X.row(i), X.row(cand[j]), D));
+                s += d2[i];
+            }
+            part[t] = s;
+        }
+        cost = std::accumulate(part.begin(), part.end(), 0.0);
+    }
+
+    // Poucos candidatos (dados com muitas repetições): completa com sorteio
+    std::sort(cand.begin(), cand.end());
+    cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+    if ((int)cand.size() <= K) {
+        Matrix<double> C(K, D);
+        for (int k = 0; k < (int)cand.size(); k++) std::copy_n(X.row(cand[k]), D, C.row(k));
+        // Os K sorteados são distintos, então sobram ao menos K - |cand| fora de cand
+        int k = static_cast<int>(cand.size());
+        for (int i : init_indices(N, K, seed)) {
+            if (k == K) break;
+            if (!std::binary_search(cand.begin(), cand.end(), i)) std::copy_n(X.row(i), D, C.row(k++));
+        }
+        return C;
+    }
+
+    // Peso de cada candidato = pontos mais próximos dele
+    const int M = static_cast<int>(cand.size());
+    Matrix<double> P(M, D);
+    for (int j = 0; j < M; j++) std::copy_n(X.row(cand[j]), D, P.row(j));
+    std::vector<std::vector<double>> wpart(T, std::vector<double>(M, 0.0));
+    #pragma omp parallel for schedule(static) num_threads(T)
+    for (int t = 0; t < T; t++) {
+        int lo, hi;
+        range(N, T, t, lo, hi);
+        for (int i = lo; i < hi; i++)
+            wpart[t][kern.nearest(X.row(i), P.data(), P.stride(), M, D, nullptr)] += 1.0;
+    }
+    std::vector<double> w(M, 0.0);
+    for (int t = 0; t < T; t++)
+        for (int j = 0; j < M; j++) w[j] += wpart[t][j];
+
+    // Reagrupa os candidatos: kmeans++ ponderado + Lloyd ponderado
+    Matrix<double> C(K, D);
+    weighted_kmeanspp(P, w, K, kern, rng, C);
+    Matrix<double> sum(K, D);
+    std::vector<double> cnt(K);
+    for (int it = 0; it < KMPAR_LLOYD_ITERS; it++) {
+        sum.zero();
+        std::fill(cnt.begin(), cnt.end(), 0.0);
+        for (int j = 0; j < M; j++) {
+            const int k = kern.nearest(P.row(j), C.data(), C.stride(), K, D, nullptr);
+            cnt[k] += w[j];
+            for (int d = 0; d < D; d++) sum(k, d) += w[j] * P(j, d);
+        }
+        for (int k = 0; k < K; k++) {
+            if (cnt[k] <= 0.0) continue;
+            for (int d = 0; d < D; d++) C(k, d) = sum(k, d) / cnt[k];
+        }
+    }
+    return C;
+}
+
+// -----------------------------------------------------------------------------
+// init_centroids: escolhe o método pelo nome (--init=random|kmeans++|kmeans||).
+// -----------------------------------------------------------------------------
+inline Matrix<double> init_centroids(const std::string& method, const Matrix<double>& X, int N, int K,
+                                     const DistanceKernel& kern, uint64_t seed) {
+    if (method == "kmeans++") return init_kmeanspp(X, N, K, kern, seed);
+    if (method == "kmeans||") return init_kmeans_parallel(X, N, K, kern, seed);
+    const int D = static_cast<int>(X.cols());
+    Matrix<double> C(K, D);
+    std::vector<int> idx = init_indices(N, K, seed);
+    for (int k = 0; k < K; k++) std::copy_n(X.row(idx[k]), D, C.row(k));
+    return C;
+}
@@ -1,4 +1,10 @@
 #include <bits/stdc++.h>
+#include "dataset.h"
+#include "distance.h"
+#include "init.h"
+#include "matrix.h"
+#include "options.h"
+#include "pruned.h"
 using namespace std;
 
 // ─────────── CONFIGURAÇÃO ───────────
@@ -7,129 +13,131 @@ using namespace std;
 #define DEFAULT_K       10
 #define DEFAULT_MAX_IT  150
 #define SKIP_HEADER     true
+#define VERIFY_CHECKSUM false   // confere o checksum ao abrir um .kmb
 // ─────────────────────────────────────
 
-// Lê CSV numérico, opcionalmente pula header e remove a última coluna (rótulo)
-vector<vector<double>> load_csv(const string& filename) {
-    ifstream in(filename);
-    if (!in) {
-        cerr << "Erro ao abrir arquivo: " << filename << endl;
-        exit(1);
+int main(int argc, char* argv[]) {
+    // modo de conversão: convert <entrada.csv> <saida.kmb>
+    if (argc >= 2 && string(argv[1]) == "convert")
+        return convert_main(argc, argv, SKIP_HEADER);
+
+    // argumentos: [K] [max_iter] [arquivo (.csv ou .kmb)] [--algo=lloyd|hamerly|elkan|yinyang]
+    //             [--init=random|kmeans++|kmeans||] [--seed=S] [--profile=trace.json|.csv [--perf]]
+    //             [--update=full|delta]
+    Options opt = parse_options(argc, argv);
+    if (opt.has("profile")) {
+        string trace = opt.get("profile", "");
+        profiler().enable(trace == "1" ? "profile.json" : trace, opt.has("perf"));
     }
-    vector<vector<double>> data;
-    string line;
-#if SKIP_HEADER
-    // pula a primeira linha de cabeçalho
-    if (!getline(in, line)) {
-        cerr << "Arquivo vazio ou sem header para pular\n";
-        exit(1);
+    int K        = opt.arg_int(0, DEFAULT_K);
+    int max_iter = opt.arg_int(1, DEFAULT_MAX_IT);
+    string filename = opt.arg(2, DATA_FILE);
+    string algo  = opt.get("algo", "lloyd");
+    if (algo != "lloyd" && algo != "hamerly" && algo != "elkan" && algo != "yinyang") {
+        cerr << "Algoritmo inválido: " << algo << " (use lloyd, hamerly, elkan ou yinyang)\n";
+        return 1;
     }
-#endif
-    while (getline(in, line)) {
-        // limpa CR/LF e vírgula final
-        while (!line.empty() && (line.back()=='\r' || line.back()=='\n' || line.back()==','))
-            line.pop_back();
-        if (line.empty()) continue;
-
-        stringstream ss(line);
-        vector<double> row;
-        string cell;
-        while (getline(ss, cell, ',')) {
-            // trim espaços
-            cell.erase(cell.begin(), find_if(cell.begin(), cell.end(), [](unsigned char c){ return !isspace(c); }));
-            cell.erase(find_if(cell.rbegin(), cell.rend(), [](unsigned char c){ return !isspace(c); }).base(), cell.end());
-            try {
-                row.push_back(stod(cell));
-            } catch (invalid_argument&) {
-                // ignora qualquer token não convertido
-            }
-        }
-        // remove a última coluna (suposto rótulo)
-        if (!row.empty()) row.pop_back();
-        if (!row.empty()) data.emplace_back(move(row));
+    string init  = opt.get("init", "random");
+    uint64_t seed = opt.get_int("seed", 1234);
+    if (init != "random" && init != "kmeans++" && init != "kmeans||") {
+        cerr << "Inicialização inválida: " << init << " (use random, kmeans++ ou kmeans||)\n";
+        return 1;
     }
-    return data;
-}
-
-// Distância Euclidiana
-double euclid(const vector<double>& a, const vector<double>& b) {
-    double sum = 0;
-    for (size_t i = 0; i < a.size(); i++) {
-        double d = a[i] - b[i];
-        sum += d*d;
+    // delta: somas mantidas entre iterações, só os pontos que mudaram são aplicados
+    string update = opt.get("update", "full");
+    if (update != "full" && update != "delta") {
+        cerr << "Atualização inválida: " << update << " (use full ou delta)\n";
+        return 1;
     }
-    return sqrt(sum);
-}
-
-int main(int argc, char* argv[]) {
-    // argumentos: [K] [max_iter] [arquivo]
-    int K        = (argc >= 2 ? stoi(argv[1]) : DEFAULT_K);
-    int max_iter = (argc >= 3 ? stoi(argv[2]) : DEFAULT_MAX_IT);
-    string filename = (argc >= 4 ? argv[3] : DATA_FILE);
+    const bool delta = update == "delta";
 
-    auto data = load_csv(filename);
-    int N = data.size();
+    Dataset ds = [&] {
+        ProfileScope s("load");
+        return load_dataset(filename, SKIP_HEADER, VERIFY_CHECKSUM);
+    }();
+    int N = ds.N;
     if (N == 0) {
         cerr << "Nenhuma amostra carregada de " << filename << "\n";
         return 1;
     }
-    int D = data[0].size();
+    int D = ds.D;
     cout << "→ Carreguei " << N << " amostras de " << filename
          << " (dim=" << D << ")\n";
 
+    // kernel de distância ao quadrado (SIMD conforme a CPU)
+    DistanceKernel kern = select_kernel(D);
+    cout << "→ Kernel de distância: " << kern.name << "\n";
+
     if (K <= 0 || K > N) {
         cerr << "Valor de K inválido: " << K << "\n";
         return 1;
     }
 
-    // inicializa centróides distintos
-    vector<vector<double>> centroids;
-    mt19937_64 rng(1234);
-    uniform_int_distribution<int> pick(0, N-1);
-    unordered_set<int> used;
-    while ((int)centroids.size() < K) {
-        int idx = pick(rng);
-        if (used.insert(idx).second)
-            centroids.push_back(data[idx]);
-    }
+    // inicializa centróides (amostras distintas, kmeans++ ou kmeans||)
+    Matrix<double> centroids = [&] {
+        ProfileScope s("init");
+        return init_centroids(init, ds.X, N, K, kern, seed);
+    }();
 
     vector<int> labels(N, -1);
+    auto t_run = chrono::steady_clock::now();
+    int done = 0;   // iterações que atualizaram os centróides
+    int delta_updates = 0;
+    long long moved = 0;
+    // hamerly/elkan/yinyang: mesmos rótulos, pulando distâncias pelos limites
+    if (algo != "lloyd") {
+        KMeansResult res = kmeans_pruned(algo, ds.X, N, centroids, max_iter, kern, delta);
+        if (res.converged) cout << "Convergiu em " << res.iterations << " iterações.\n";
+        cout << "→ " << algo << ": " << res.dist_computed << " de " << res.dist_full
+             << " distâncias calculadas (" << setprecision(1) << fixed
+             << 100.0 * (res.dist_full - res.dist_computed) / res.dist_full << "% evitadas)\n";
+        centroids = std::move(res.centroids);
+        labels = std::move(res.labels);
+        done = res.iterations;
+        delta_updates = res.delta_updates;
+        moved = res.moved;
+        max_iter = 0;   // pula o laço abaixo
+    }
+    RunningSums upd(K, D, delta);   // somas em ordem fixa de blocos (igual às outras versões)
     for (int iter = 0; iter < max_iter; iter++) {
-        bool changed = false;
+        done = iter + 1;
+        IterationScope it_scope(iter);
+        long long changed = 0;
+        double inertia = 0.0;
         // atribuição
-        for (int i = 0; i < N; i++) {
-            double best = numeric_limits<double>::infinity();
-            int who = 0;
-            for (int k = 0; k < K; k++) {
-                double d = euclid(data[i], centroids[k]);
-                if (d < best) { best = d; who = k; }
+        {
+            ProfileScope s("assign", iter);
+            for (int i = 0; i < N; i++) {
+                double best;
+                int who = kern.nearest(ds.row(i), centroids.data(), centroids.stride(), K, D, &best);
+                inertia += best;
+                if (labels[i] != who) { upd.move(i, labels[i], who); labels[i] = who; changed++; }
             }
-            if (labels[i] != who) { labels[i] = who; changed = true; }
         }
+        it_scope.set(inertia, changed);
         if (!changed) {
             cout << "Convergiu em " << iter << " iterações.\n";
+            done = iter;
             break;
         }
         // recomputa centróides
-        vector<vector<double>> sum(K, vector<double>(D, 0.0));
-        vector<int> count(K, 0);
-        for (int i = 0; i < N; i++) {
-            int k = labels[i];
-            count[k]++;
-            for (int d = 0; d < D; d++) sum[k][d] += data[i][d];
-        }
-        for (int k = 0; k < K; k++) {
-            if (count[k] == 0) continue;
-            for (int d = 0; d < D; d++)
-                centroids[k][d] = sum[k][d] / count[k];
+        ProfileScope s("update", iter);
+        if (long long applied = upd.update(ds.X, N, labels, centroids); applied >= 0) {
+            delta_updates++;
+            moved += applied;
         }
     }
+    cout << "→ " << done << " iterações em " << defaultfloat << setprecision(6)
+         << chrono::duration<double>(chrono::steady_clock::now() - t_run).count() << " s\n";
+    if (delta)
+        cout << "→ Atualização incremental: " << delta_updates << " de " << done
+             << " atualizações por deltas (" << moved << " pontos movidos)\n";
 
     // saída
     cout << fixed << setprecision(4);
     for (int k = 0; k < K; k++) {
         cout << "Centróide " << k << ": ";
-        for (double v : centroids[k]) cout << v << " ";
+        for (int d = 0; d < D; d++) cout << centroids(k, d) << " ";
         cout << "\n";
     }
     vector<int> sz(K, 0);
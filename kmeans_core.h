@@ -0,0 +1,457 @@
+// kmeans_core.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "gemm_assign.h"
+#include "matrix.h"
+#include "profile.h"
+#include "topology.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Núcleo do K-Means compartilhado pelos algoritmos (Lloyd e variantes com
+// poda). Recebe os centróides iniciais, devolve centróides finais, rótulos e
+// estatísticas. Com -fopenmp os laços rodam em paralelo; sem, em uma thread.
+//
+// O Lloyd e a redução são templates no tipo de armazenamento T (pontos e
+// centróides: double ou float) e no tipo do acumulador Acc (somas da
+// atualização, double por padrão): --precision=f32 usa T = float, Acc = double.
+// -----------------------------------------------------------------------------
+
+struct KMeansResult {
+    Matrix<double> centroids;   // K×D finais
+    std::vector<int> labels;    // rótulo de cada ponto
+    int iterations = 0;         // iterações que atualizaram os centróides
+    bool converged = false;     // true se parou por não haver mudança de rótulo
+    long long dist_computed = 0;  // distâncias ponto-centróide calculadas
+    long long dist_full = 0;      // quantas o Lloyd completo calcularia (N·K por iteração)
+    long long dist_centroid = 0;  // distâncias centróide-centróide (poda)
+    int delta_updates = 0;        // atualizações feitas só com os pontos movidos
+    long long moved = 0;          // pontos movidos nessas atualizações
+};
+
+#define REDUCE_BLOCK 4096   // linhas por soma parcial (fixa a ordem das somas)
+#define DELTA_REFRESH 16    // atualizações por deltas entre duas recomputações completas
+#define DELTA_MAX_MOVED 0.25  // fração de pontos movidos acima da qual recomputa tudo
+
+// -----------------------------------------------------------------------------
+// CentroidSums: somas e contagens por centróide acumuladas numa ordem fixa.
+// As linhas são divididas em blocos de REDUCE_BLOCK; cada bloco é somado em
+// sequência numa área parcial (uma por thread) e as parciais entram no total
+// na ordem dos blocos. O resultado não depende do número de threads nem de
+// como as linhas chegam (todas de uma vez ou em pedaços múltiplos de
+// REDUCE_BLOCK): o caminho em memória e o fora da memória dão os mesmos bits.
+//
+// As áreas parciais são alocadas uma vez, cada uma pela thread dona (fica no
+// nó NUMA dela) e em linhas de cache próprias. O bloco w de cada leva vai
+// sempre para a thread w (schedule(static, 1)), o mesmo mapeamento usado por
+// first_touch_copy. assign_add() atribui e acumula na mesma passada sobre os
+// dados, lendo os centróides de uma cópia no nó da thread quando as threads
+// estão fixadas em mais de um nó; a junção das parciais é paralela sobre K×D
+// (pedaços de uma linha de cache), sem seção crítica.
+// -----------------------------------------------------------------------------
+template <typename T, typename Acc = double>
+class CentroidSumsT {
+public:
+    CentroidSumsT(int K, int D) : K_(K), D_(D), sum_(K, D), count_(K, 0) {
+        slots_ = 1;
+#ifdef _OPENMP
+        slots_ = omp_get_max_threads();
+#endif
+        part_.resize(slots_);
+        #pragma omp parallel for schedule(static, 1)
+        for (int w = 0; w < slots_; w++) {
+            part_[w].sum.reset(K, D);
+            part_[w].count.reset(1, K);
+        }
+    }
+
+    void clear() {
+        sum_.zero();
+        std::fill(count_.begin(), count_.end(), 0);
+    }
+
+    // Soma as n primeiras linhas de X (rótulos em labels). Chamadas seguidas
+    // continuam a sequência de blocos: n deve ser múltiplo de REDUCE_BLOCK,
+    // exceto na última.
+    void add(const Matrix<T>& X, int n, const int* labels) {
+        pass(X, n, [labels](int, int i, T*) { return labels[i]; }, nullptr, nullptr);
+    }
+
+    // Atribui cada linha ao centróide mais próximo de C e já a soma (mesma
+    // ordem de add). Atualiza labels; devolve quantos rótulos mudaram. Se
+    // inertia != nullptr, recebe a soma das distâncias² da atribuição (somada
+    // por bloco, na ordem dos blocos).
+    long long assign_add(const Matrix<T>& X, int n, const Matrix<T>& C,
+                         const DistanceKernelT<T>& kern, int* labels, double* inertia = nullptr) {
+        const auto nearest = kern.nearest;
+        const int K = K_, D = D_;
+        const size_t cs = C.stride();
+        replicate(C);
+        return pass(X, n, [&](int w, int i, T* best) {
+            return nearest(X.row(i), cview_[w], cs, K, D, best);
+        }, labels, inertia);
+    }
+
+    // Cada centróide vira a média dos seus pontos; sem pontos, fica onde estava
+    void apply(Matrix<T>& C) const {
+        for (int k = 0; k < K_; k++) {
+            if (count_[k] == 0) continue; // evita divisão por zero
+            for (int d = 0; d < D_; d++) {
+                C(k, d) = static_cast<T>(sum_(k, d) / count_[k]);
+            }
+        }
+    }
+
+    const Matrix<Acc>& sum() const { return sum_; }
+    const std::vector<long long>& count() const { return count_; }
+
+private:
+    // Percorre os blocos em levas de slots_; label(w, i, best) dá o rótulo da
+    // linha i (w = thread/área parcial) e, se best != nullptr, a distância².
+    // Com out != nullptr os rótulos são gravados lá e as mudanças contadas.
+    template <typename Label>
+    long long pass(const Matrix<T>& X, int n, Label label, int* out, double* dist) {
+        const int K = K_, D = D_;
+        const int nb = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+        long long changed = 0;
+        if (dist) block_dist_.assign(nb, 0.0);
+        for (int b0 = 0; b0 < nb; b0 += slots_) {
+            const int wn = std::min(slots_, nb - b0);
+            // Cada bloco da leva vai para a sua área parcial
+            #pragma omp parallel for schedule(static, 1) reduction(+:changed)
+            for (int w = 0; w < wn; w++) {
+                Matrix<Acc>& ps = part_[w].sum;
+                long long* pc = part_[w].count.data();
+                ps.zero();
+                std::fill(pc, pc + K, 0);
+                const int i0 = (b0 + w) * REDUCE_BLOCK;
+                const int i1 = std::min(n, i0 + REDUCE_BLOCK);
+                double bd = 0.0;
+                for (int i = i0; i < i1; i++) {
+                    T best = 0;
+                    const int c = label(w, i, dist ? &best : nullptr);
+                    bd += best;
+                    if (out && out[i] != c) {
+                        out[i] = c;
+                        changed++;
+                    }
+                    const T* x = X.row(i);
+                    Acc* s = ps.row(c);
+                    pc[c]++;
+                    for (int d = 0; d < D; d++) {
+                        s[d] += x[d];
+                    }
+                }
+                if (dist) block_dist_[b0 + w] = bd;
+            }
+            merge(wn);
+        }
+        if (dist) *dist = std::accumulate(block_dist_.begin(), block_dist_.end(), 0.0);
+        return changed;
+    }
+
+    // Parciais entram no total na ordem dos blocos; cada thread cuida de
+    // pedaços (centróide, linha de cache) do K×D
+    void merge(int wn) {
+        const int K = K_, D = D_;
+        constexpr int L = 64 / sizeof(Acc);
+        const int pieces = (D + L - 1) / L;
+        #pragma omp parallel for schedule(static)
+        for (int e = 0; e < K * pieces; e++) {
+            const int k = e / pieces;
+            const int d0 = (e % pieces) * L, d1 = std::min(D, d0 + L);
+            Acc* s = sum_.row(k);
+            for (int w = 0; w < wn; w++) {
+                const Acc* ps = part_[w].sum.row(k);
+                for (int d = d0; d < d1; d++) {
+                    s[d] += ps[d];
+                }
+            }
+        }
+        for (int w = 0; w < wn; w++) {
+            const long long* pc = part_[w].count.data();
+            for (int k = 0; k < K; k++) count_[k] += pc[k];
+        }
+    }
+
+    // Aponta cview_[w] para os centróides que a thread w deve ler: C ou a
+    // cópia do nó dela (gravada pela primeira thread do nó)
+    void replicate(const Matrix<T>& C) {
+        const ThreadPlacement& tp = thread_placement();
+        cview_.assign(slots_, C.data());
+        if (tp.nodes <= 1 || (int)tp.node.size() < slots_) return;
+        replica_.resize(tp.nodes);
+        #pragma omp parallel num_threads(slots_)
+        {
+            const int t = topo_detail::thread_id();
+            const int j = tp.node[t];
+            if (std::find(tp.node.begin(), tp.node.end(), j) - tp.node.begin() == t) {
+                Matrix<T>& r = replica_[j];
+                if (r.rows() != C.rows()) r.reset(C.rows(), C.cols());
+                for (size_t k = 0; k < C.rows(); k++) std::copy_n(C.row(k), C.cols(), r.row(k));
+            }
+        }
+        for (int w = 0; w < slots_; w++) cview_[w] = replica_[tp.node[w]].data();
+    }
+
+    struct Partial {
+        Matrix<Acc> sum;          // K×D
+        Matrix<long long> count;  // 1×K
+    };
+
+    int K_, D_, slots_;
+    Matrix<Acc> sum_;
+    std::vector<long long> count_;
+    std::vector<Partial> part_;      // uma área parcial por thread
+    std::vector<Matrix<T>> replica_; // centróides por nó NUMA
+    std::vector<const T*> cview_;    // centróides lidos por cada thread
+    std::vector<double> block_dist_; // distância² de cada bloco (assign_add)
+};
+
+using CentroidSums = CentroidSumsT<double>;
+
+// -----------------------------------------------------------------------------
+// update_centroids: recalcula cada centróide como média dos pontos atribuídos.
+// acc é a área de trabalho do chamador (alocada uma vez).
+// -----------------------------------------------------------------------------
+template <typename T, typename Acc>
+void update_centroids(const Matrix<T>& X, int N, const std::vector<int>& labels,
+                      Matrix<T>& C, CentroidSumsT<T, Acc>& acc) {
+    acc.clear();
+    acc.add(X, N, labels.data());
+    acc.apply(C);
+}
+
+// -----------------------------------------------------------------------------
+// RunningSums: somas e contagens mantidas entre iterações (--update=delta).
+// Os laços de atribuição chamam move(i, de, para) para cada rótulo que muda;
+// cada thread anota na sua lista. update() aplica só esses deltas
+// (soma[de] -= x, soma[para] += x), em O(movidos·D), e recalcula a média. A
+// cada DELTA_REFRESH atualizações, ou quando mais de DELTA_MAX_MOVED dos
+// pontos mudou, as somas são refeitas do zero com CentroidSums, o que limita
+// o erro de arredondamento acumulado. Os deltas são aplicados ordenados por
+// (centróide, ponto), então o resultado não depende do número de threads.
+// Com incremental = false, update() é o update_centroids de sempre.
+// -----------------------------------------------------------------------------
+template <typename T, typename Acc = double>
+class RunningSumsT {
+public:
+    RunningSumsT(int K, int D, bool incremental)
+        : K_(K), D_(D), incremental_(incremental), acc_(K, D) {
+        if (!incremental) return;
+        sum_.reset(K, D);
+        count_.assign(K, 0);
+        moves_.resize(topo_detail::num_threads());
+    }
+
+    bool incremental() const { return incremental_; }
+
+    // O ponto i saiu de `from` (-1 = nenhum) e foi para `to`; pode ser
+    // chamado de dentro de laços paralelos
+    void move(int i, int from, int to) {
+        if (incremental_ && valid_) moves_[topo_detail::thread_id()].v.push_back({i, from, to});
+    }
+
+    // Atualiza C; devolve quantos pontos foram aplicados como delta (-1 se
+    // foi uma recomputação completa)
+    long long update(const Matrix<T>& X, int N, const std::vector<int>& labels, Matrix<T>& C) {
+        if (!incremental_) {
+            update_centroids(X, N, labels, C, acc_);
+            return -1;
+        }
+        size_t m = 0;
+        for (const auto& l : moves_) m += l.v.size();
+        long long applied = -1;
+        if (!valid_ || since_full_ >= DELTA_REFRESH || m > DELTA_MAX_MOVED * N) {
+            acc_.clear();
+            acc_.add(X, N, labels.data());
+            for (int k = 0; k < K_; k++) std::copy_n(acc_.sum().row(k), D_, sum_.row(k));
+            count_ = acc_.count();
+            valid_ = true;
+            since_full_ = 0;
+        } else {
+            apply_moves(X);
+            since_full_++;
+            applied = static_cast<long long>(m);
+        }
+        for (auto& l : moves_) l.v.clear();
+        for (int k = 0; k < K_; k++) {
+            if (count_[k] == 0) continue; // evita divisão por zero
+            for (int d = 0; d < D_; d++) {
+                C(k, d) = static_cast<T>(sum_(k, d) / count_[k]);
+            }
+        }
+        return applied;
+    }
+
+private:
+    struct Move { int i, from, to; };
+    struct alignas(64) MoveList { std::vector<Move> v; };   // sem falso compartilhamento
+    struct Delta { int k, i, sign; };
+
+    void apply_moves(const Matrix<T>& X) {
+        deltas_.clear();
+        for (const auto& l : moves_) {
+            for (const Move& mv : l.v) {
+                if (mv.from >= 0) deltas_.push_back({mv.from, mv.i, -1});
+                deltas_.push_back({mv.to, mv.i, +1});
+            }
+        }
+        std::sort(deltas_.begin(), deltas_.end(), [](const Delta& a, const Delta& b) {
+            return a.k != b.k ? a.k < b.k : a.i < b.i;
+        });
+        // Um trecho por centróide; trechos em paralelo
+        std::vector<size_t> start;
+        for (size_t j = 0; j < deltas_.size(); j++)
+            if (j == 0 || deltas_[j].k != deltas_[j - 1].k) start.push_back(j);
+        start.push_back(deltas_.size());
+        const int D = D_;
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int s = 0; s < (int)start.size() - 1; s++) {
+            const int k = deltas_[start[s]].k;
+            Acc* sum = sum_.row(k);
+            for (size_t j = start[s]; j < start[s + 1]; j++) {
+                const T* x = X.row(deltas_[j].i);
+                if (deltas_[j].sign > 0) {
+                    for (int d = 0; d < D; d++) sum[d] += x[d];
+                } else {
+                    for (int d = 0; d < D; d++) sum[d] -= x[d];
+                }
+                count_[k] += deltas_[j].sign;
+            }
+        }
+    }
+
+    int K_, D_;
+    bool incremental_;
+    CentroidSumsT<T, Acc> acc_;          // recomputação completa
+    Matrix<Acc> sum_;                    // somas correntes
+    std::vector<long long> count_;
+    std::vector<MoveList> moves_;        // uma lista por thread
+    std::vector<Delta> deltas_;
+    bool valid_ = false;
+    int since_full_ = 0;
+};
+
+using RunningSums = RunningSumsT<double>;
+
+// -----------------------------------------------------------------------------
+// init_indices: K amostras distintas sorteadas entre N (semente fixa), usadas
+// como centróides iniciais por todas as versões.
+// -----------------------------------------------------------------------------
+inline std::vector<int> init_indices(int N, int K, uint64_t seed = 1234) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pick(0, N - 1);
+    std::unordered_set<int> used;
+    std::vector<int> idx;
+    while ((int)idx.size() < K) {
+        int i = pick(rng);
+        if (used.insert(i).second) idx.push_back(i);
+    }
+    return idx;
+}
+
+// -----------------------------------------------------------------------------
+// inertia: soma das distâncias ao quadrado de cada ponto ao seu centróide,
+// sempre em double (compara resultados de precisões diferentes)
+// -----------------------------------------------------------------------------
+inline double inertia(const Matrix<double>& X, int N, const std::vector<int>& labels,
+                      const Matrix<double>& C, const DistanceKernel& kern) {
+    const int D = static_cast<int>(C.cols());
+    double total = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:total)
+    for (int i = 0; i < N; i++) {
+        total += kern.sqdist(X.row(i), C.row(labels[i]), D);
+    }
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+// kmeans_lloyd: K-Means clássico. Cada iteração calcula as K distâncias de
+// todos os pontos (ou usa o GEMM em blocos, se gemm != nullptr; só em double)
+// e recalcula os centróides, acumulando em Acc; para quando nenhum rótulo muda
+// ou após max_iter iterações. Os centróides finais voltam em double. Com
+// delta, a atribuição anota os pontos movidos e a atualização usa RunningSums.
+// -----------------------------------------------------------------------------
+template <typename T, typename Acc = double>
+KMeansResult kmeans_lloyd(const Matrix<T>& X, int N, Matrix<T> C, int max_iter,
+                          const DistanceKernelT<T>& kern, GemmAssigner* gemm = nullptr,
+                          bool delta = false) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    KMeansResult res;
+    // Vetor de rótulos para cada amostra
+    res.labels.assign(N, -1);
+    std::vector<int>& labels = res.labels;
+    // Somas e contagens globais da etapa de atualização
+    CentroidSumsT<T, Acc> acc(K, D);
+    std::optional<RunningSumsT<T, Acc>> rs;
+    std::vector<int> prev;   // rótulos antes do GEMM (para achar os movidos)
+    if (delta) rs.emplace(K, D, true);
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        res.dist_computed += (long long)N * K;
+        res.dist_full += (long long)N * K;
+        IterationScope it_scope(iter);
+        // Etapa 1: Atribuição de cada ponto ao centróide mais próximo (em paralelo)
+        // Sem GEMM, a etapa 2 (somas da média) é feita na mesma passada
+        long long changed = 0;
+        double in = std::numeric_limits<double>::quiet_NaN();   // só com --profile
+        if (gemm) {
+            ProfileScope s("assign", iter);
+            if (rs) prev = labels;
+            if constexpr (std::is_same<T, double>::value) changed = gemm->assign(C, K, labels);
+            if (rs) {
+                for (int i = 0; i < N; i++)
+                    if (prev[i] != labels[i]) rs->move(i, prev[i], labels[i]);
+            }
+        } else if (rs) {
+            // Só atribuição; as somas andam pelos pontos movidos
+            ProfileScope s("assign", iter);
+            const auto nearest = kern.nearest;
+            double total = 0.0;
+            #pragma omp parallel for schedule(static) reduction(+:changed, total)
+            for (int i = 0; i < N; i++) {
+                T best;
+                const int k = nearest(X.row(i), C.data(), C.stride(), K, D, &best);
+                total += best;
+                if (labels[i] != k) {
+                    rs->move(i, labels[i], k);
+                    labels[i] = k;
+                    changed++;
+                }
+            }
+            if (profiler().enabled) in = total;
+        } else {
+            ProfileScope s("assign+accumulate", iter);
+            acc.clear();
+            changed = acc.assign_add(X, N, C, kern, labels.data(), profiler().enabled ? &in : nullptr);
+        }
+        it_scope.set(in, changed);
+        // Se não houve mudança nos rótulos, considera convergido
+        if (changed == 0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+        // Etapa 2: Recalcula os centróides como média dos pontos atribuídos
+        ProfileScope s("update", iter);
+        if (rs) {
+            const long long applied = rs->update(X, N, labels, C);
+            if (applied >= 0) {
+                res.delta_updates++;
+                res.moved += applied;
+            }
+        } else if (gemm) {
+            update_centroids(X, N, labels, C, acc);
+        } else {
+            acc.apply(C);
+        }
+    }
+    if constexpr (std::is_same<T, double>::value) res.centroids = std::move(C);
+    else res.centroids = matrix_cast<double>(C);
+    return res;
+}
@@ -3,6 +3,8 @@
 
 #include <bits/stdc++.h>
 #include <cuda_runtime.h>
+#include "dataset.h"
+#include "matrix.h"
 using namespace std;
 
 // ─────────── CONFIGURAÇÃO ───────────
@@ -10,48 +12,21 @@ using namespace std;
 #define DEFAULT_K       10               // Número de clusters
 #define DEFAULT_MAX_IT 150              // Máximo de iterações
 #define SKIP_HEADER     true             // Pular primeira linha (header)
+#define VERIFY_CHECKSUM false            // Conferir checksum ao abrir .kmb
 // ─────────────────────────────────────
 
-// Função para carregar CSV no host (retorna vector[N][D])
-vector<vector<double>> load_csv(const string& filename) {
-    ifstream in(filename);
-    if (!in) {
-        cerr << "Erro ao abrir arquivo: " << filename << "\n";
-        exit(1);
-    }
-    vector<vector<double>> data;
-    string line;
-#if SKIP_HEADER
-    getline(in, line);  // descarta header
-#endif
-    while (getline(in, line)) {
-        while (!line.empty() && (line.back()=='\r' || line.back()=='\n' || line.back()==','))
-            line.pop_back();
-        if (line.empty()) continue;
-        stringstream ss(line);
-        vector<double> row;
-        string cell;
-        while (getline(ss, cell, ',')) {
-            try { row.push_back(stod(cell)); } catch (...) {}
-        }
-        if (!row.empty()) row.pop_back();
-        if (!row.empty()) data.emplace_back(move(row));
-    }
-    return data;
-}
-
 // Kernel CUDA: atribui cada ponto ao cluster mais próximo
 __global__ void assign_labels(const double* data,
                               const double* centroids,
                               int* labels,
-                              int N, int D, int K) {
+                              int N, int D, int K, size_t S, size_t CS) {
     int idx = blockIdx.x * blockDim.x + threadIdx.x;
     if (idx >= N) return;
-    const double* p = data + idx * D;
+    const double* p = data + idx * S;
     double best_dist = 1e300;
     int best_k = 0;
     for (int k = 0; k < K; ++k) {
-        const double* c = centroids + k * D;
+        const double* c = centroids + k * CS;
         double dist = 0;
         #pragma unroll
         for (int d = 0; d < D; ++d) {
@@ -64,23 +39,31 @@ __global__ void assign_labels(const double* data,
 }
 
 int main(int argc, char* argv[]) {
+    // Modo de conversão CSV → binário: convert <entrada.csv> <saida.kmb>
+    if (argc >= 2 && string(argv[1]) == "convert")
+        return convert_main(argc, argv, SKIP_HEADER);
+
     int K = (argc >= 2 ? stoi(argv[1]) : DEFAULT_K);
     int max_iter = (argc >= 3 ? stoi(argv[2]) : DEFAULT_MAX_IT);
+    string filename = (argc >= 4 ? argv[3] : DATA_FILE);
 
     // Carrega dados no host
-    auto host_data = load_csv(DATA_FILE);
-    int N = host_data.size();
-    int D = host_data[0].size();
+    Dataset ds = load_dataset(filename, SKIP_HEADER, VERIFY_CHECKSUM);
+    int N = ds.N;
+    if (N == 0) {
+        cerr << "Nenhuma amostra carregada de " << filename << "\n";
+        return 1;
+    }
+    int D = ds.D;
     cout << "→ Carreguei " << N << " amostras (dim=" << D << ")\n";
 
-    // Flatten dados em vetor contínuo
-    vector<double> flat_data(N * D);
-    for (int i = 0; i < N; ++i) {
-        memcpy(flat_data.data() + i * D, host_data[i].data(), D * sizeof(double));
-    }
+    // Dados já vêm contíguos (CSV) ou mapeados (.kmb), linhas com passo S
+    const double* flat_data = ds.X.data();
+    const size_t S = ds.stride();
 
-    // Host: centroids e labels
-    vector<double> h_centroids(K * D);
+    // Host: centroids (Matrix alinhada, passo CS) e labels
+    Matrix<double> h_centroids(K, D);
+    const size_t CS = h_centroids.stride();
     vector<int> h_labels(N, -1);
 
     // Inicialização randômica dos centróides
@@ -90,7 +73,7 @@ int main(int argc, char* argv[]) {
     for (int k = 0; k < K; ) {
         int idx = pick(rng);
         if (used.insert(idx).second) {
-            copy_n(flat_data.data() + idx * D, D, h_centroids.begin() + k * D);
+            copy_n(flat_data + idx * S, D, h_centroids.row(k));
             ++k;
         }
     }
@@ -98,40 +81,40 @@ int main(int argc, char* argv[]) {
     // Alocação de memória na GPU
     double *d_data, *d_centroids;
     int *d_labels;
-    cudaMalloc(&d_data, N * D * sizeof(double));
-    cudaMalloc(&d_centroids, K * D * sizeof(double));
+    cudaMalloc(&d_data, N * S * sizeof(double));
+    cudaMalloc(&d_centroids, K * CS * sizeof(double));
     cudaMalloc(&d_labels, N * sizeof(int));
 
     // Cópia inicial de dados para GPU
-    cudaMemcpy(d_data, flat_data.data(), N * D * sizeof(double), cudaMemcpyHostToDevice);
+    cudaMemcpy(d_data, flat_data, N * S * sizeof(double), cudaMemcpyHostToDevice);
 
     int threadsPerBlock = 256;
     int blocks = (N + threadsPerBlock - 1) / threadsPerBlock;
 
     // Loop principal K-means
     for (int it = 0; it < max_iter; ++it) {
-        cudaMemcpy(d_centroids, h_centroids.data(), K * D * sizeof(double), cudaMemcpyHostToDevice);
-        assign_labels<<<blocks, threadsPerBlock>>>(d_data, d_centroids, d_labels, N, D, K);
+        cudaMemcpy(d_centroids, h_centroids.data(), K * CS * sizeof(double), cudaMemcpyHostToDevice);
+        assign_labels<<<blocks, threadsPerBlock>>>(d_data, d_centroids, d_labels, N, D, K, S, CS);
         cudaDeviceSynchronize();
         cudaMemcpy(h_labels.data(), d_labels, N * sizeof(int), cudaMemcpyDeviceToHost);
 
         // Recalcula centróides no host
-        vector<vector<double>> sum(K, vector<double>(D, 0.0));
+        Matrix<double> sum(K, D);
         vector<int> count(K, 0);
         bool changed = false;
         for (int i = 0; i < N; ++i) {
             int lbl = h_labels[i];
             ++count[lbl];
             for (int d = 0; d < D; ++d) {
-                sum[lbl][d] += flat_data[i * D + d];
+                sum(lbl, d) += flat_data[i * S + d];
             }
         }
         for (int k = 0; k < K; ++k) {
             if (count[k] > 0) {
                 for (int d = 0; d < D; ++d) {
-                    double new_val = sum[k][d] / count[k];
-                    if (fabs(new_val - h_centroids[k * D + d]) > 1e-6) changed = true;
-                    h_centroids[k * D + d] = new_val;
+                    double new_val = sum(k, d) / count[k];
+                    if (fabs(new_val - h_centroids(k, d)) > 1e-6) changed = true;
+                    h_centroids(k, d) = new_val;
                 }
             }
         }
@@ -145,7 +128,7 @@ int main(int argc, char* argv[]) {
     cout << fixed << setprecision(4);
     for (int k = 0; k < K; ++k) {
         cout << "Centróide " << k << ": ";
-        for (int d = 0; d < D; ++d) cout << h_centroids[k * D + d] << " ";
+        for (int d = 0; d < D; ++d) cout << h_centroids(k, d) << " ";
         cout << "\n";
     }
 
@@ -0,0 +1,387 @@
+// kmeans_mpi.cpp
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <mpi.h>
+#include <omp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "csv_loader.h"
+#include "dataset.h"
+#include "distance.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#include "options.h"
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Projeto: K-Means com vários processos MPI (dados repartidos por linhas)
+// Descrição: versão de open_mp_cpu.cpp para rodar com `mpirun -np P`. Cada
+// processo lê só a sua faixa de linhas do arquivo, com pread a partir do
+// deslocamento: no .kmb a faixa sai direto do cabeçalho; no CSV o arquivo é
+// dividido em P faixas de bytes e cada linha pertence ao processo em cuja
+// faixa ela começa. Dentro do processo a atribuição e as somas usam as
+// threads OpenMP (CentroidSums, como no Lloyd em memória).
+//
+// A cada iteração as somas K×D, as contagens e o número de rótulos mudados
+// são combinados com MPI_Iallreduce. As linhas vão em MPI_PIPELINE pedaços,
+// do tamanho calculado sobre a maior faixa (o mesmo número de reduções em
+// todos os processos): a redução de um pedaço corre enquanto o seguinte é
+// atribuído, e os totais são somados na ordem dos pedaços, então todos os
+// processos aplicam exatamente a mesma atualização.
+//
+// Resultado: os mesmos rótulos, tamanhos de cluster e centróides (na
+// precisão impressa) do open_mp_cpu; só a ordem das somas entre processos
+// muda, o que mexe no último bit de alguns centróides. Inicialização só
+// random: os K índices são sorteados como em init_indices sobre o N global e
+// cada processo contribui com as linhas que tem.
+// -----------------------------------------------------------------------------
+
+// ─────────── CONFIGURAÇÃO ───────────────────────────────────────────────────────
+// DATA_FILE:      Caminho padrão para o arquivo de entrada (.csv ou .kmb)
+// DEFAULT_K:      Valor default de K (número de clusters)
+// DEFAULT_MAX_IT: Valor default de iterações máximas
+// SKIP_HEADER:    Define se a primeira linha (header) do CSV deve ser ignorada
+// NUM_THREADS:    Threads por processo (0 = OMP_NUM_THREADS ou CPUs do nó
+//                 divididas entre os processos do mesmo nó)
+// MPI_PIPELINE:   Pedaços por iteração (redução de um junto com o cálculo do próximo)
+// CSV_READ_AHEAD: Bytes lidos de cada vez para achar o fim de uma linha no CSV
+// ────────────────────────────────────────────────────────────────────────────────
+#define DATA_FILE       "covtype.csv"
+#define DEFAULT_K       10
+#define DEFAULT_MAX_IT  150
+#define SKIP_HEADER     true
+#define NUM_THREADS     0
+#define MPI_PIPELINE    4
+#define CSV_READ_AHEAD  (1 << 20)
+
+// Linhas deste processo
+struct LocalRows {
+    Matrix<double> X;     // n×D
+    int n = 0;
+    int D = 0;
+    long long first = 0;  // índice global da primeira linha
+    long long N = 0;      // total de linhas em todos os processos
+};
+
+// Erro de E/S num processo: derruba todos
+[[noreturn]] static void die(const string& msg) {
+    cerr << msg << endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    exit(1);
+}
+
+static void pread_all(int fd, void* buf, size_t bytes, off_t off, const string& filename) {
+    char* p = static_cast<char*>(buf);
+    while (bytes > 0) {
+        const ssize_t r = pread(fd, p, bytes, off);
+        if (r <= 0) die("Erro ao ler " + filename);
+        p += r;
+        bytes -= r;
+        off += r;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// .kmb: faixa [N·r/P, N·(r+1)/P) lida do payload pelo deslocamento
+// -----------------------------------------------------------------------------
+static LocalRows read_kmb_range(const string& filename, int rank, int procs) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) die("Erro ao abrir arquivo: " + filename);
+    KmbHeader h{};
+    struct stat st;
+    if (fstat(fd, &st) != 0) die("Erro ao abrir arquivo: " + filename);
+    pread_all(fd, &h, sizeof(h), 0, filename);
+    if (!kmb_header_valid(h, static_cast<uint64_t>(st.st_size)))
+        die("Arquivo binário inválido ou incompatível: " + filename);
+    const uint64_t lo = h.n * rank / procs, hi = h.n * (rank + 1) / procs;
+    LocalRows L;
+    L.n = static_cast<int>(hi - lo);
+    L.D = static_cast<int>(h.d);
+    L.X.reset(L.n, L.D);
+    const off_t off = h.data_offset + lo * h.stride * sizeof(double);
+    if (L.X.stride() == h.stride) {
+        // Mesmo passo com padding da Matrix: uma leitura só
+        pread_all(fd, L.X.data(), static_cast<size_t>(L.n) * h.stride * sizeof(double), off, filename);
+    } else {
+        vector<double> row(h.stride);
+        for (int i = 0; i < L.n; i++) {
+            pread_all(fd, row.data(), row.size() * sizeof(double), off + i * h.stride * sizeof(double), filename);
+            copy_n(row.data(), L.D, L.X.row(i));
+        }
+    }
+    close(fd);
+    return L;
+}
+
+// -----------------------------------------------------------------------------
+// CSV: faixa de bytes [b0, b1) dos dados; as linhas que começam nela são
+// convertidas em paralelo (só as com D valores + rótulo, como no RowSource)
+// -----------------------------------------------------------------------------
+static LocalRows read_csv_range(const string& filename, bool skip_header, int rank, int procs) {
+    using namespace csv_detail;
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) die("Erro ao abrir arquivo: " + filename);
+    struct stat st;
+    fstat(fd, &st);
+    const off_t size = st.st_size;
+
+    // Início dos dados e D a partir da primeira linha com conteúdo
+    string head(min<off_t>(size, CSV_READ_AHEAD), '\0');
+    pread_all(fd, head.data(), head.size(), 0, filename);
+    size_t p = 0;
+    if (skip_header) {
+        const size_t nl = head.find('\n');
+        p = nl == string::npos ? head.size() : nl + 1;
+    }
+    const off_t data0 = p;
+    LocalRows L;
+    while (p < head.size()) {
+        size_t nl = head.find('\n', p);
+        if (nl == string::npos) nl = head.size();
+        const char* te = trim_line_end(&head[p], head.data() + nl);
+        const int cols = te > &head[p] ? parse_line(&head[p], te, nullptr, 0) : 0;
+        if (cols > 1) {
+            L.D = cols - 1;
+            break;
+        }
+        p = nl + 1;
+    }
+    if (L.D == 0) die("Nenhuma amostra em " + filename);
+
+    // Lê [b0 - 1, fim da linha que contém b1 - 1): o byte anterior diz se b0
+    // já é começo de linha
+    const off_t span = size - data0;
+    const off_t b0 = data0 + span * rank / procs, b1 = data0 + span * (rank + 1) / procs;
+    string buf;
+    if (b1 > b0) {
+        const off_t r0 = b0 > data0 ? b0 - 1 : b0;
+        buf.resize(b1 - r0);
+        pread_all(fd, buf.data(), buf.size(), r0, filename);
+        off_t pos = b1;
+        while (buf.back() != '\n' && pos < size) {
+            string more(min<off_t>(CSV_READ_AHEAD, size - pos), '\0');
+            pread_all(fd, more.data(), more.size(), pos, filename);
+            const size_t nl = more.find('\n');
+            buf.append(more, 0, nl == string::npos ? more.size() : nl + 1);
+            pos += more.size();
+            if (nl != string::npos) break;
+        }
+        size_t start = 0;
+        if (b0 > data0) {
+            const size_t nl = buf.find('\n');
+            start = nl == string::npos ? buf.size() : nl + 1;
+        }
+        buf.erase(0, start);
+    }
+    close(fd);
+
+    // Pedaços alinhados em começo de linha; cada thread converte o seu
+    const int D = L.D;
+    const int chunks = max(1, min(omp_get_max_threads() * 4, static_cast<int>(buf.size() >> 16)));
+    vector<size_t> bounds(chunks + 1, buf.size());
+    bounds[0] = 0;
+    for (int c = 1; c < chunks; c++) {
+        size_t q = max(bounds[c - 1], buf.size() * c / chunks);
+        const size_t nl = buf.find('\n', q);
+        bounds[c] = nl == string::npos ? buf.size() : nl + 1;
+    }
+    vector<vector<double>> part(chunks);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunks; c++) {
+        vector<double> row(D);
+        for (size_t q = bounds[c]; q < bounds[c + 1];) {
+            size_t nl = buf.find('\n', q);
+            if (nl == string::npos || nl > bounds[c + 1]) nl = bounds[c + 1];
+            const char* te = trim_line_end(&buf[q], buf.data() + nl);
+            if (te > &buf[q] && parse_line(&buf[q], te, row.data(), D) == D + 1)
+                part[c].insert(part[c].end(), row.begin(), row.end());
+            q = nl + 1;
+        }
+    }
+    vector<int> first(chunks + 1, 0);
+    for (int c = 0; c < chunks; c++) first[c + 1] = first[c] + static_cast<int>(part[c].size() / D);
+    L.n = first[chunks];
+    L.X.reset(L.n, D);
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < chunks; c++)
+        for (int i = first[c]; i < first[c + 1]; i++) copy_n(&part[c][static_cast<size_t>(i - first[c]) * D], D, L.X.row(i));
+    return L;
+}
+
+// -----------------------------------------------------------------------------
+// Imprime os centróides finais e o tamanho de cada cluster
+static void print_clusters(const Matrix<double>& centroids, const vector<long long>& cluster_size) {
+    const int K = centroids.rows(), D = centroids.cols();
+    cout << fixed << setprecision(4);
+    for (int k = 0; k < K; k++) {
+        cout << "Centróide " << k << ": ";
+        for (int d = 0; d < D; d++) {
+            cout << centroids(k, d) << " ";
+        }
+        cout << endl;
+    }
+    for (int k = 0; k < K; k++) {
+        cout << "Cluster " << k << " tem " << cluster_size[k] << " pontos" << endl;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Função principal: main
+// Argumentos: [K] [max_iter] [arquivo (.csv ou .kmb)] [--seed=S] [--threads=T]
+int main(int argc, char* argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank, procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &procs);
+    const bool root = rank == 0;
+
+    // Threads por processo: sem indicação, as CPUs do nó são divididas entre
+    // os processos que rodam nele
+    Options opt = parse_options(argc, argv);
+    MPI_Comm node;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    int local_procs;
+    MPI_Comm_size(node, &local_procs);
+    MPI_Comm_free(&node);
+    int threads = opt.get_int("threads", NUM_THREADS);
+    if (threads == 0 && !getenv("OMP_NUM_THREADS")) threads = max(1, omp_get_num_procs() / local_procs);
+    if (threads > 0) omp_set_num_threads(threads);
+
+    int K = opt.arg_int(0, DEFAULT_K);
+    int max_iter = opt.arg_int(1, DEFAULT_MAX_IT);
+    string filename = opt.arg(2, DATA_FILE);
+    uint64_t seed = opt.get_int("seed", 1234);   // semente fixa para reprodutibilidade
+    if (opt.get("init", "random") != "random") {
+        if (root) cerr << "kmeans_mpi só suporta --init=random" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (root) cout << "Número de threads: " << omp_get_max_threads() << " por processo, "
+                   << procs << " processo(s)" << endl;
+
+    // Cada processo lê só a sua faixa de linhas
+    auto t_load = chrono::steady_clock::now();
+    LocalRows L = is_kmb_file(filename) ? read_kmb_range(filename, rank, procs)
+                                        : read_csv_range(filename, SKIP_HEADER, rank, procs);
+    long long n_local = L.n;
+    MPI_Exscan(&n_local, &L.first, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) L.first = 0;
+    MPI_Allreduce(&n_local, &L.N, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    const int D = L.D;
+    const long long N = L.N;
+    if (root) cout << "→ Carreguei " << N << " amostras de " << filename << " (dim=" << D << ") em "
+                   << chrono::duration<double>(chrono::steady_clock::now() - t_load).count()
+                   << " s, " << procs << " faixa(s) de linhas" << endl;
+    if (N == 0 || N > INT_MAX || K <= 0 || K > N) {
+        if (root) cerr << "Valor de K inválido: " << K << " (N=" << N << ")" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    DistanceKernel kern = select_kernel(D);
+    if (root) cout << "→ Kernel de distância: " << kern.name << endl;
+
+    // Centróides iniciais: mesmos índices do init_indices; cada linha vem do
+    // processo que a tem (os outros somam zero)
+    Matrix<double> C(K, D);
+    {
+        vector<int> idx = init_indices(static_cast<int>(N), K, seed);
+        vector<double> mine(static_cast<size_t>(K) * D, 0.0), all(mine.size());
+        for (int k = 0; k < K; k++) {
+            const long long i = idx[k] - L.first;
+            if (i >= 0 && i < L.n) copy_n(L.X.row(i), D, &mine[static_cast<size_t>(k) * D]);
+        }
+        MPI_Allreduce(mine.data(), all.data(), K * D, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        for (int k = 0; k < K; k++) copy_n(&all[static_cast<size_t>(k) * D], D, C.row(k));
+    }
+
+    // Pedaços locais múltiplos de REDUCE_BLOCK; dois conjuntos de somas e de
+    // buffers: enquanto um pedaço é reduzido, o próximo é calculado. O tamanho
+    // sai da maior faixa para que todos os processos façam o mesmo número de
+    // MPI_Iallreduce; quem tem menos linhas manda pedaços vazios (somas zero)
+    long long max_n = 0;
+    MPI_Allreduce(&n_local, &max_n, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    const int per = max(1, static_cast<int>((max_n + MPI_PIPELINE - 1) / MPI_PIPELINE));
+    const int csz = (per + REDUCE_BLOCK - 1) / REDUCE_BLOCK * REDUCE_BLOCK;
+    const int chunks = max(1, static_cast<int>((max_n + csz - 1) / csz));
+    const int E = K * D + K + 1;   // somas, contagens e rótulos mudados
+    CentroidSums acc0(K, D), acc1(K, D);
+    CentroidSums* acc[2] = {&acc0, &acc1};
+    vector<double> send[2] = {vector<double>(E), vector<double>(E)};
+    vector<double> recv[2] = {vector<double>(E), vector<double>(E)};
+    MPI_Request req[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    bool pending[2] = {false, false};
+    vector<double> total(E);
+    vector<int> labels(L.n, -1);
+    double wait_secs = 0.0;
+    // Soma ao total o pedaço que está no buffer b (na ordem em que foram enviados)
+    auto drain = [&](int b) {
+        if (!pending[b]) return;
+        auto tw = chrono::steady_clock::now();
+        MPI_Wait(&req[b], MPI_STATUS_IGNORE);
+        wait_secs += chrono::duration<double>(chrono::steady_clock::now() - tw).count();
+        for (int e = 0; e < E; e++) total[e] += recv[b][e];
+        pending[b] = false;
+    };
+
+    auto t_run = chrono::steady_clock::now();
+    int iterations = 0;
+    bool converged = false;
+    for (int iter = 0; iter < max_iter; iter++) {
+        iterations = iter + 1;
+        fill(total.begin(), total.end(), 0.0);
+        for (int c = 0; c < chunks; c++) {
+            const int b = c & 1;
+            drain(b);
+            const int lo = min(L.n, c * csz), n = min(L.n, lo + csz) - lo;
+            acc[b]->clear();
+            long long changed = 0;
+            if (n > 0) {
+                Matrix<double> view(L.X.row(lo), n, D, L.X.stride());
+                changed = acc[b]->assign_add(view, n, C, kern, labels.data() + lo);
+            }
+            const Matrix<double>& s = acc[b]->sum();
+            for (int k = 0; k < K; k++) copy_n(s.row(k), D, &send[b][static_cast<size_t>(k) * D]);
+            for (int k = 0; k < K; k++) send[b][K * D + k] = acc[b]->count()[k];
+            send[b][K * D + K] = changed;
+            MPI_Iallreduce(send[b].data(), recv[b].data(), E, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &req[b]);
+            pending[b] = true;
+            // Dá andamento à redução anterior enquanto o próximo pedaço é calculado
+            if (pending[b ^ 1]) {
+                int done;
+                MPI_Test(&req[b ^ 1], &done, MPI_STATUS_IGNORE);
+            }
+        }
+        drain(chunks & 1);
+        drain((chunks - 1) & 1);
+        // Se não houve mudança nos rótulos, considera convergido
+        if (total[K * D + K] == 0) {
+            iterations = iter;
+            converged = true;
+            break;
+        }
+        // Cada centróide vira a média dos seus pontos; sem pontos, fica onde estava
+        for (int k = 0; k < K; k++) {
+            const long long cnt = static_cast<long long>(total[K * D + k]);
+            if (cnt == 0) continue;
+            for (int d = 0; d < D; d++) C(k, d) = total[static_cast<size_t>(k) * D + d] / cnt;
+        }
+    }
+    const double run_secs = chrono::duration<double>(chrono::steady_clock::now() - t_run).count();
+    double max_wait = 0.0;
+    MPI_Reduce(&wait_secs, &max_wait, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (root) {
+        if (converged) {
+            cout << "Convergiu em " << iterations << " iterações." << endl;
+        }
+        cout << "→ " << iterations << " iterações em " << run_secs << " s (espera pela redução: até "
+             << max_wait << " s por processo)" << endl;
+        // Tamanhos dos clusters: contagens globais da última atribuição
+        vector<long long> cluster_size(K);
+        for (int k = 0; k < K; k++) cluster_size[k] = static_cast<long long>(total[K * D + k]);
+        print_clusters(C, cluster_size);
+    }
+    MPI_Finalize();
+    return 0;
+}
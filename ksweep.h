@@ -0,0 +1,224 @@
+// ksweep.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "init.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#include "topology.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Varredura de K (--k-range=a:b) sobre o dataset já carregado.
+//
+// Cada K parte da solução de K-1: o cluster de maior inércia é dividido em
+// dois ao longo do seu eixo principal (iteração da potência sobre a
+// covariância dos pontos dele), c ± sqrt(2λ/π)·v, que são as médias das duas
+// metades de uma gaussiana. Só o primeiro K de cada faixa usa --init.
+//
+// A faixa é repartida em `lanes` faixas contíguas, com soma de K parecida, e
+// as faixas rodam ao mesmo tempo (OpenMP aninhado), cada uma com T/lanes
+// threads. Com lanes = 1 a cadeia inteira usa o time todo, um K por vez.
+//
+// Para cada K: inércia, iterações, tempo e a silhueta simplificada (com as
+// distâncias aos centróides: a = ao próprio, b = ao segundo mais próximo,
+// s = (b - a)/max(a, b), média sobre os pontos), que custa uma passada O(N·K).
+// As somas são feitas em blocos de REDUCE_BLOCK linhas, na ordem dos blocos,
+// então a tabela não depende do número de threads.
+// -----------------------------------------------------------------------------
+
+#define SWEEP_POWER_ITERS 8   // iterações da potência para o eixo principal
+
+struct KSweepRow {
+    int K = 0;
+    double inertia = 0.0;
+    double silhouette = 0.0;   // silhueta simplificada, em [-1, 1]
+    int iterations = 0;
+    bool converged = false;
+    double secs = 0.0;         // divisão + Lloyd + avaliação deste K
+    int lane = 0;
+};
+
+namespace sweep_detail {
+
+// Soma ordenada por blocos: f(lo, hi, part) acumula as linhas [lo, hi) em
+// part (W valores); as parciais são somadas na ordem dos blocos
+template <typename F>
+std::vector<double> blocked_sum(int N, int W, F f) {
+    const int nb = (N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    std::vector<double> part(static_cast<size_t>(nb) * W, 0.0), out(W, 0.0);
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nb; b++)
+        f(b * REDUCE_BLOCK, std::min(N, (b + 1) * REDUCE_BLOCK), &part[static_cast<size_t>(b) * W]);
+    for (int b = 0; b < nb; b++)
+        for (int w = 0; w < W; w++) out[w] += part[static_cast<size_t>(b) * W + w];
+    return out;
+}
+
+// Rótulos finais, inércia de cada cluster (K valores) e soma das silhuetas
+// (posição K) com os centróides C
+inline std::vector<double> evaluate(const Matrix<double>& X, int N, const Matrix<double>& C,
+                                    const DistanceKernel& kern, std::vector<int>& labels) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    return blocked_sum(N, K + 1, [&](int lo, int hi, double* part) {
+        for (int i = lo; i < hi; i++) {
+            const double* x = X.row(i);
+            double a = std::numeric_limits<double>::infinity(), b = a;
+            int best = 0;
+            for (int k = 0; k < K; k++) {
+                const double d = kern.sqdist(x, C.row(k), D);
+                if (d < a) { b = a; a = d; best = k; }
+                else if (d < b) b = d;
+            }
+            labels[i] = best;
+            part[best] += a;
+            if (K > 1) {
+                const double sa = std::sqrt(a), sb = std::sqrt(b);
+                if (sb > 0.0) part[K] += (sb - sa) / sb;   // b >= a, então max(a, b) = b
+            }
+        }
+    });
+}
+
+// K+1 centróides: o cluster w de C é trocado pelas duas metades do seu eixo
+// principal
+inline Matrix<double> split_cluster(const Matrix<double>& X, int N, const Matrix<double>& C,
+                                    const std::vector<int>& labels, int w, const DistanceKernel& kern) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    const double* c = C.row(w);
+    Matrix<double> out(K + 1, D);
+    for (int k = 0; k < K; k++) std::copy_n(C.row(k), D, out.row(k));
+
+    // Ponto mais distante do cluster: direção inicial (e plano B)
+    int far = -1;
+    double far_d = -1.0;
+    for (int i = 0; i < N; i++) {
+        if (labels[i] != w) continue;
+        const double d = kern.sqdist(X.row(i), c, D);
+        if (d > far_d) { far_d = d; far = i; }
+    }
+    if (far < 0 || far_d <= 0.0) {
+        // Cluster vazio ou de pontos repetidos: o novo centróide é a amostra
+        // mais distante do próprio centróide
+        int i_max = 0;
+        double d_max = -1.0;
+        for (int i = 0; i < N; i++) {
+            const double d = kern.sqdist(X.row(i), C.row(labels[i]), D);
+            if (d > d_max) { d_max = d; i_max = i; }
+        }
+        std::copy_n(X.row(i_max), D, out.row(K));
+        return out;
+    }
+
+    std::vector<double> v(D);
+    for (int d = 0; d < D; d++) v[d] = X(far, d) - c[d];
+    double lambda = 0.0, members = 0.0;
+    for (int it = 0; it < SWEEP_POWER_ITERS; it++) {
+        double norm = 0.0;
+        for (double e : v) norm += e * e;
+        norm = std::sqrt(norm);
+        for (double& e : v) e /= norm;
+        // y = Σ (x - c)((x - c)·v) sobre os pontos do cluster; posição D = contagem
+        std::vector<double> y = blocked_sum(N, D + 1, [&](int lo, int hi, double* part) {
+            for (int i = lo; i < hi; i++) {
+                if (labels[i] != w) continue;
+                const double* x = X.row(i);
+                double p = 0.0;
+                for (int d = 0; d < D; d++) p += (x[d] - c[d]) * v[d];
+                for (int d = 0; d < D; d++) part[d] += (x[d] - c[d]) * p;
+                part[D] += 1.0;
+            }
+        });
+        members = y[D];
+        double ny = 0.0;
+        for (int d = 0; d < D; d++) ny += y[d] * y[d];
+        lambda = std::sqrt(ny) / members;
+        if (ny == 0.0) break;
+        for (int d = 0; d < D; d++) v[d] = y[d];
+    }
+    double norm = 0.0;
+    for (double e : v) norm += e * e;
+    norm = std::sqrt(norm);
+    const double step = std::sqrt(2.0 * lambda / M_PI) / norm;
+    for (int d = 0; d < D; d++) {
+        out(w, d) = c[d] - step * v[d];
+        out(K, d) = c[d] + step * v[d];
+    }
+    return out;
+}
+
+}  // namespace sweep_detail
+
+// -----------------------------------------------------------------------------
+// kmeans_sweep: Lloyd para K = a..b; uma linha da tabela por K
+// -----------------------------------------------------------------------------
+inline std::vector<KSweepRow> kmeans_sweep(const Matrix<double>& X, int N, int a, int b, int lanes,
+                                           int max_iter, const DistanceKernel& kern,
+                                           const std::string& init, uint64_t seed) {
+    using namespace sweep_detail;
+    const int count = b - a + 1;
+    lanes = std::max(1, std::min(lanes, count));
+    std::vector<KSweepRow> rows(count);
+
+    // Faixas contíguas com soma de K parecida (o custo cresce com K)
+    std::vector<int> first(lanes + 1, b + 1);
+    {
+        const double total = 0.5 * (a + b) * count;
+        double acc = 0.0;
+        int lane = 0;
+        first[0] = a;
+        for (int K = a; K <= b && lane + 1 < lanes; K++) {
+            acc += K;
+            if (acc >= total * (lane + 1) / lanes && K < b) first[++lane] = K + 1;
+        }
+    }
+
+    const int T = topo_detail::num_threads();
+    const int inner = std::max(1, T / lanes);
+#ifdef _OPENMP
+    const int saved_levels = omp_get_max_active_levels();
+    if (lanes > 1) omp_set_max_active_levels(2);
+#endif
+    #pragma omp parallel for schedule(static, 1) num_threads(lanes) if (lanes > 1)
+    for (int l = 0; l < lanes; l++) {
+        // A thread da faixa está fixada numa CPU só: o time interno fica com a
+        // fatia das CPUs das threads l·inner .. (l+1)·inner - 1
+        std::optional<ScopedCpuSlice> slice;
+        if (lanes > 1) slice.emplace(l * inner, (l + 1) * inner);
+#ifdef _OPENMP
+        if (lanes > 1) omp_set_num_threads(inner);
+#endif
+        Matrix<double> C;
+        std::vector<int> labels(N);
+        std::vector<double> ev;
+        for (int K = first[l]; K < first[l + 1]; K++) {
+            const auto t0 = std::chrono::steady_clock::now();
+            if (K == first[l]) {
+                C = init_centroids(init, X, N, K, kern, seed);
+            } else {
+                // Divide o cluster de maior inércia da solução anterior
+                const int w = static_cast<int>(std::max_element(ev.begin(), ev.end() - 1) - ev.begin());
+                C = split_cluster(X, N, C, labels, w, kern);
+            }
+            KMeansResult res = kmeans_lloyd(X, N, std::move(C), max_iter, kern);
+            C = std::move(res.centroids);
+            ev = evaluate(X, N, C, kern, labels);
+            KSweepRow& row = rows[K - a];
+            row.K = K;
+            row.inertia = std::accumulate(ev.begin(), ev.end() - 1, 0.0);
+            row.silhouette = ev[K] / N;
+            row.iterations = res.iterations;
+            row.converged = res.converged;
+            row.lane = l;
+            row.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+    }
+#ifdef _OPENMP
+    omp_set_max_active_levels(saved_levels);
+#endif
+    return rows;
+}
@@ -0,0 +1,114 @@
+// matrix.h
+#pragma once
+#include <bits/stdc++.h>
+
+// -----------------------------------------------------------------------------
+// Matrix<T>: matriz densa row-major alinhada a linha de cache.
+// Cada linha começa em um endereço múltiplo de 64 bytes: o passo entre linhas
+// (stride) é o número de colunas arredondado para cima até completar 64 bytes,
+// e as colunas extras ficam zeradas. Assim uma única alocação guarda N linhas,
+// o laço interno pode ser vetorizado sem tratar caudas desalinhadas e a mesma
+// estrutura serve para pontos, centróides e acumuladores.
+//
+// Também pode ser uma "visão" (não dona) sobre memória externa, por exemplo
+// um arquivo .kmb mapeado, desde que o layout seja o mesmo.
+// -----------------------------------------------------------------------------
+
+#define MATRIX_ALIGN 64
+
+template <typename T>
+class Matrix {
+public:
+    static size_t padded_stride(size_t cols) {
+        const size_t per_line = MATRIX_ALIGN / sizeof(T);
+        return (cols + per_line - 1) / per_line * per_line;
+    }
+
+    Matrix() = default;
+
+    // Aloca rows×cols, zerado (inclusive o padding). Com zero = false a
+    // memória não é tocada: quem preenche decide o nó NUMA de cada página e
+    // precisa zerar o padding.
+    Matrix(size_t rows, size_t cols, bool zero = true) { reset(rows, cols, zero); }
+
+    // Visão sobre memória externa (não libera nada no destrutor)
+    Matrix(T* data, size_t rows, size_t cols, size_t stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride), owner_(false) {}
+
+    Matrix(const Matrix& o) { *this = o; }
+    Matrix& operator=(const Matrix& o) {
+        if (this == &o) return *this;
+        reset(o.rows_, o.cols_);
+        for (size_t i = 0; i < rows_; i++) std::copy_n(o.row(i), cols_, row(i));
+        return *this;
+    }
+    Matrix(Matrix&& o) noexcept { swap(o); }
+    Matrix& operator=(Matrix&& o) noexcept {
+        Matrix tmp(std::move(o));
+        swap(tmp);
+        return *this;
+    }
+    ~Matrix() { release(); }
+
+    void swap(Matrix& o) noexcept {
+        std::swap(data_, o.data_); std::swap(rows_, o.rows_);
+        std::swap(cols_, o.cols_); std::swap(stride_, o.stride_);
+        std::swap(owner_, o.owner_);
+    }
+
+    // Realoca para rows×cols zerado (ou sem tocar, se zero = false)
+    void reset(size_t rows, size_t cols, bool zero = true) {
+        release();
+        rows_ = rows;
+        cols_ = cols;
+        stride_ = padded_stride(cols);
+        owner_ = true;
+        size_t bytes = std::max<size_t>(MATRIX_ALIGN, rows_ * stride_ * sizeof(T));
+        bytes = (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+        data_ = static_cast<T*>(std::aligned_alloc(MATRIX_ALIGN, bytes));
+        if (!data_) throw std::bad_alloc();
+        if (zero) std::memset(static_cast<void*>(data_), 0, bytes);
+    }
+
+    // Zera todos os elementos (mantém a alocação)
+    void zero() { std::memset(static_cast<void*>(data_), 0, rows_ * stride_ * sizeof(T)); }
+
+    T* row(size_t i) { return data_ + i * stride_; }
+    const T* row(size_t i) const { return data_ + i * stride_; }
+    T& operator()(size_t i, size_t j) { return data_[i * stride_ + j]; }
+    const T& operator()(size_t i, size_t j) const { return data_[i * stride_ + j]; }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t stride() const { return stride_; }
+    size_t size() const { return rows_ * stride_; }  // elementos incluindo padding
+    bool owner() const { return owner_; }
+
+private:
+    void release() {
+        if (owner_ && data_) std::free(data_);
+        data_ = nullptr;
+        rows_ = cols_ = stride_ = 0;
+    }
+
+    T* data_ = nullptr;
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    size_t stride_ = 0;
+    bool owner_ = false;
+};
+
+// Cópia com outro tipo de elemento (mesmas linhas e colunas, novo passo)
+template <typename U, typename T>
+Matrix<U> matrix_cast(const Matrix<T>& m) {
+    Matrix<U> out(m.rows(), m.cols());
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)m.rows(); i++) {
+        const T* src = m.row(i);
+        U* dst = out.row(i);
+        for (size_t j = 0; j < m.cols(); j++) dst[j] = static_cast<U>(src[j]);
+    }
+    return out;
+}
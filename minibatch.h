@@ -0,0 +1,124 @@
+// minibatch.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#include "row_source.h"
+
+// -----------------------------------------------------------------------------
+// K-Means em mini-lotes (Sculley, 2010) para dados maiores que a memória.
+//
+// A cada passo B linhas aleatórias são lidas do arquivo mapeado, atribuídas
+// em paralelo e cada centróide anda em direção à média dos seus pontos do
+// lote com taxa própria eta_k = n_k / (v_k + n_k), onde v_k é quantos pontos
+// ele já recebeu (equivale a aplicar eta = 1/v_k ponto a ponto). A inércia
+// média do lote é suavizada (média móvel exponencial); se a variação relativa
+// dela fica abaixo de MINIBATCH_TOL por MINIBATCH_PATIENCE lotes seguidos, o
+// laço para. Memória: O(B·D + K·D), independente de N.
+// -----------------------------------------------------------------------------
+
+#define MINIBATCH_SMOOTHING 0.1    // peso do lote novo na inércia suavizada
+#define MINIBATCH_TOL       1e-3   // variação relativa considerada "parada"
+#define MINIBATCH_PATIENCE  10     // lotes seguidos abaixo da tolerância
+
+struct MiniBatchResult {
+    Matrix<double> centroids;               // K×D finais
+    int batches = 0;                        // lotes processados
+    bool early_stop = false;                // parou pela inércia suavizada
+    double smoothed_inertia = 0.0;          // inércia média suavizada no fim
+    std::vector<long long> cluster_size;    // da varredura final
+    long long rows = 0;                     // linhas vistas na varredura final
+    double inertia = 0.0;                   // soma das distâncias² na varredura final
+};
+
+// Atribui as n primeiras linhas de M; devolve a soma das distâncias ao quadrado
+inline double assign_block(const Matrix<double>& M, int n, const Matrix<double>& C,
+                           const DistanceKernel& kern, std::vector<int>& labels) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    double inertia = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:inertia)
+    for (int j = 0; j < n; j++) {
+        double best;
+        labels[j] = kern.nearest(M.row(j), C.data(), C.stride(), K, D, &best);
+        inertia += best;
+    }
+    return inertia;
+}
+
+// -----------------------------------------------------------------------------
+// kmeans_minibatch: centróides iniciais = K linhas sorteadas (distintas);
+// max_batches limita o número de lotes. No fim faz uma varredura sequencial
+// do arquivo, em blocos de B linhas, para contar os clusters e a inércia.
+// -----------------------------------------------------------------------------
+inline MiniBatchResult kmeans_minibatch(RowSource& src, int K, int B, int max_batches,
+                                        const DistanceKernel& kern, uint64_t seed) {
+    const int D = src.dim();
+    MiniBatchResult res;
+    std::mt19937_64 rng(seed);
+
+    Matrix<double>& C = res.centroids;
+    C.reset(K, D);
+    src.sample(rng, K, C);
+    // Troca linhas repetidas (centróides iguais nunca se separam)
+    for (int k = 1; k < K; k++) {
+        for (int tries = 0; tries < 32; tries++) {
+            bool dup = false;
+            for (int j = 0; j < k && !dup; j++) dup = std::equal(C.row(k), C.row(k) + D, C.row(j));
+            if (!dup) break;
+            Matrix<double> one(1, D);
+            src.sample(rng, 1, one);
+            std::copy_n(one.row(0), D, C.row(k));
+        }
+    }
+
+    Matrix<double> batch(B, D), mean(K, D);
+    CentroidSums acc(K, D);
+    std::vector<int> labels(B);
+    std::vector<long long> seen(K, 0);   // v_k
+    double ewa = 0.0;
+    int calm = 0;
+
+    for (int t = 0; t < max_batches; t++) {
+        src.sample(rng, B, batch);
+        double inertia = assign_block(batch, B, C, kern, labels) / B;
+
+        // Média do lote por centróide (mesma redução do Lloyd) e passo eta_k
+        update_centroids(batch, B, labels, mean, acc);
+        const std::vector<long long>& count = acc.count();
+        for (int k = 0; k < K; k++) {
+            if (count[k] == 0) continue;
+            seen[k] += count[k];
+            const double eta = static_cast<double>(count[k]) / seen[k];
+            double* c = C.row(k);
+            const double* m = mean.row(k);
+            for (int d = 0; d < D; d++) c[d] += eta * (m[d] - c[d]);
+        }
+        res.batches = t + 1;
+
+        // Parada pela variação da inércia suavizada
+        if (t == 0) {
+            ewa = inertia;
+            continue;
+        }
+        const double prev = ewa;
+        ewa = MINIBATCH_SMOOTHING * inertia + (1.0 - MINIBATCH_SMOOTHING) * ewa;
+        calm = (std::abs(prev - ewa) <= MINIBATCH_TOL * prev) ? calm + 1 : 0;
+        if (calm >= MINIBATCH_PATIENCE) {
+            res.early_stop = true;
+            break;
+        }
+    }
+    res.smoothed_inertia = ewa;
+
+    // Varredura final: tamanhos dos clusters e inércia total
+    res.cluster_size.assign(K, 0);
+    src.rewind();
+    for (int n; (n = src.read_block(B, batch)) > 0; ) {
+        res.inertia += assign_block(batch, n, C, kern, labels);
+        for (int j = 0; j < n; j++) res.cluster_size[labels[j]]++;
+        res.rows += n;
+    }
+    return res;
+}
@@ -0,0 +1,364 @@
+// model.h
+#pragma once
+#include <bits/stdc++.h>
+#include "dataset.h"
+#include "distance.h"
+#include "matrix.h"
+#include "options.h"
+#include "out_of_core.h"
+#include "row_source.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Modelo salvo (--save-model=arquivo.kmm) e modo `predict`.
+//
+// Formato .kmm (inteiros little-endian):
+//   [0, 64)                 KmmHeader
+//   [centroids_offset, ...) K×D centróides em double, sem padding
+//   [scaling_offset, ...)   D deslocamentos + D escalas (opcional): cada ponto
+//                           vira (x - deslocamento) / escala antes da distância
+//
+// O treino não normaliza os dados, então os modelos saem sem escala; o campo
+// existe para modelos treinados sobre dados transformados.
+//
+// predict lê o arquivo novo em pedaços (ChunkPrefetcher: a leitura do pedaço
+// seguinte corre junto com a atribuição do atual), atribui em paralelo e grava
+// os rótulos como int32 em sequência. Com K grande a atribuição pode usar um
+// grafo de centróides podado pela desigualdade triangular em vez de testar os
+// K; a poda depende de os dados terem clusters separados, então --index=auto
+// mede os dois caminhos nas primeiras linhas e segue com o mais rápido.
+// -----------------------------------------------------------------------------
+
+#define KMM_MAGIC       "KMEANSM"
+#define KMM_VERSION     1
+#define KMM_SCALING     1u     // flag: há deslocamento/escala por coluna
+#define PREDICT_INDEX_K 32     // --index=auto usa o grafo a partir deste K
+#define PREDICT_BLOCK   256    // linhas por tarefa; o grafo parte do rótulo anterior
+#define PREDICT_WALK    8      // vizinhos olhados em cada passo da descida gulosa
+#define PREDICT_PROBE   4096   // linhas medidas pelos dois caminhos em --index=auto
+#define PREDICT_SLACK   1e-9   // folga relativa dos limites (arredondamento)
+
+struct KmmHeader {
+    char     magic[8];          // "KMEANSM\0"
+    uint32_t version;           // KMM_VERSION
+    uint32_t flags;             // KMM_SCALING
+    uint64_t k;                 // número de centróides
+    uint64_t d;                 // dimensão
+    uint64_t n_train;           // pontos usados no treino (informativo)
+    uint64_t centroids_offset;  // início dos centróides
+    uint64_t scaling_offset;    // início da escala, 0 se ausente
+    uint64_t checksum;          // FNV-1a 64 sobre centróides + escala
+};
+static_assert(sizeof(KmmHeader) == 64, "KmmHeader deve ocupar 64 bytes");
+
+struct KMeansModel {
+    Matrix<double> centroids;            // K×D
+    std::vector<double> offset, scale;   // vazios = sem escala
+    long long n_train = 0;
+
+    int K() const { return static_cast<int>(centroids.rows()); }
+    int D() const { return static_cast<int>(centroids.cols()); }
+    bool scaled() const { return !scale.empty(); }
+};
+
+// -----------------------------------------------------------------------------
+// save_model / load_model
+// -----------------------------------------------------------------------------
+inline void save_model(const KMeansModel& m, const std::string& filename) {
+    const int K = m.K(), D = m.D();
+    std::vector<double> body(static_cast<size_t>(K) * D);
+    for (int k = 0; k < K; k++) std::copy_n(m.centroids.row(k), D, &body[static_cast<size_t>(k) * D]);
+    if (m.scaled()) {
+        body.insert(body.end(), m.offset.begin(), m.offset.end());
+        body.insert(body.end(), m.scale.begin(), m.scale.end());
+    }
+    KmmHeader h{};
+    memcpy(h.magic, KMM_MAGIC, sizeof(KMM_MAGIC));
+    h.version = KMM_VERSION;
+    h.flags = m.scaled() ? KMM_SCALING : 0;
+    h.k = K;
+    h.d = D;
+    h.n_train = m.n_train;
+    h.centroids_offset = sizeof(KmmHeader);
+    h.scaling_offset = m.scaled() ? h.centroids_offset + static_cast<uint64_t>(K) * D * sizeof(double) : 0;
+    h.checksum = kmb_checksum(body.data(), body.size() * sizeof(double));
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Erro ao criar arquivo: " << filename << std::endl;
+        exit(1);
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(body.data()), body.size() * sizeof(double));
+    if (!out) {
+        std::cerr << "Erro ao gravar " << filename << std::endl;
+        exit(1);
+    }
+}
+
+inline KMeansModel load_model(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    const uint64_t size = in ? static_cast<uint64_t>(in.tellg()) : 0;
+    KmmHeader h{};
+    if (!in || size < sizeof(h) || !in.seekg(0) || !in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+        memcmp(h.magic, KMM_MAGIC, sizeof(KMM_MAGIC)) != 0) {
+        std::cerr << "Arquivo de modelo inválido: " << filename << std::endl;
+        exit(1);
+    }
+    if (h.version != KMM_VERSION || h.k == 0 || h.d == 0 || h.k > INT_MAX || h.d > INT_MAX) {
+        std::cerr << "Versão ou dimensões do modelo não suportadas: " << filename << std::endl;
+        exit(1);
+    }
+    // Blocos dentro do arquivo; os tamanhos são comparados por divisão para
+    // que um cabeçalho forjado não estoure k·d
+    const bool scaled = h.flags & KMM_SCALING;
+    auto fits = [&](uint64_t off, uint64_t rows, uint64_t cols) {
+        return off >= sizeof(h) && off <= size && rows <= (size - off) / sizeof(double) / cols;
+    };
+    if (!fits(h.centroids_offset, h.k, h.d) || h.k * h.d > static_cast<uint64_t>(INT_MAX) ||
+        (scaled && !fits(h.scaling_offset, 2, h.d))) {
+        std::cerr << "Modelo truncado ou corrompido: " << filename << std::endl;
+        exit(1);
+    }
+    const int K = static_cast<int>(h.k), D = static_cast<int>(h.d);
+    std::vector<double> body(static_cast<size_t>(K) * D + (scaled ? 2 * static_cast<size_t>(D) : 0));
+    bool ok = static_cast<bool>(in.seekg(h.centroids_offset)) &&
+              in.read(reinterpret_cast<char*>(body.data()), static_cast<size_t>(K) * D * sizeof(double));
+    if (ok && scaled) {
+        ok = in.seekg(h.scaling_offset) &&
+             in.read(reinterpret_cast<char*>(&body[static_cast<size_t>(K) * D]), 2 * static_cast<size_t>(D) * sizeof(double));
+    }
+    if (!ok || kmb_checksum(body.data(), body.size() * sizeof(double)) != h.checksum) {
+        std::cerr << "Modelo truncado ou corrompido: " << filename << std::endl;
+        exit(1);
+    }
+    KMeansModel m;
+    m.n_train = static_cast<long long>(h.n_train);
+    m.centroids.reset(K, D);
+    for (int k = 0; k < K; k++) std::copy_n(&body[static_cast<size_t>(k) * D], D, m.centroids.row(k));
+    if (scaled) {
+        m.offset.assign(body.end() - 2 * D, body.end() - D);
+        m.scale.assign(body.end() - D, body.end());
+        for (double v : m.scale) {
+            if (!(v > 0.0) || !std::isfinite(v)) {
+                std::cerr << "Escala inválida no modelo (use valores positivos e finitos): " << filename << std::endl;
+                exit(1);
+            }
+        }
+    }
+    return m;
+}
+
+// -----------------------------------------------------------------------------
+// CentroidGraph: distâncias entre centróides e, para cada centróide, os demais
+// em ordem crescente de distância.
+//
+// Para um ponto x, partindo de um centróide s (o rótulo do ponto anterior do
+// bloco) com d_s = ||x - c_s|| e melhor atual b com d_b:
+//   - ||x - c_j|| >= ||c_s - c_j|| - d_s: a lista de s está ordenada, então
+//     quando ||c_s - c_j|| - d_s > d_b nenhum dos seguintes ganha e a busca para;
+//   - se ||c_b - c_j|| > 2·d_b, c_j não ganha de c_b e é pulado.
+// A resposta é exata: o mesmo centróide da varredura completa, com empate
+// resolvido pelo menor índice.
+// -----------------------------------------------------------------------------
+class CentroidGraph {
+public:
+    CentroidGraph(const Matrix<double>& C, const DistanceKernel& kern) : K_(static_cast<int>(C.rows())) {
+        const int D = static_cast<int>(C.cols());
+        cc_.reset(K_, K_);
+        order_.reset(K_, K_);
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (int a = 0; a < K_; a++) {
+            for (int b = 0; b < K_; b++) cc_(a, b) = std::sqrt(kern.sqdist(C.row(a), C.row(b), D));
+            int* o = order_.row(a);
+            std::iota(o, o + K_, 0);
+            std::sort(o, o + K_, [&](int i, int j) {
+                return cc_(a, i) < cc_(a, j) || (cc_(a, i) == cc_(a, j) && i < j);
+            });
+        }
+    }
+
+    // Centróide mais próximo de x partindo de s; soma em *dist as distâncias calculadas
+    int nearest(const double* x, const Matrix<double>& C, int s, SqDistFn sqdist, long long* dist) const {
+        const int D = static_cast<int>(C.cols());
+        const int walk = std::min(K_, PREDICT_WALK + 1);
+        double bsq = sqdist(x, C.row(s), D);
+        long long n = 1;
+        // Descida gulosa: vai para o melhor entre os vizinhos próximos até parar de melhorar
+        for (int cur = -1; cur != s;) {
+            cur = s;
+            const int* o = order_.row(cur);
+            for (int t = 1; t < walk; t++) {
+                const int j = o[t];
+                const double d = sqdist(x, C.row(j), D);
+                n++;
+                if (d < bsq || (d == bsq && j < s)) {
+                    bsq = d;
+                    s = j;
+                }
+            }
+        }
+        // Verificação a partir de s: só os centróides que os limites não descartam
+        const double ds = std::sqrt(bsq);
+        double bd = ds;
+        int best = s;
+        const int* o = order_.row(s);
+        const double* cs = cc_.row(s);
+        for (int t = 1; t < K_; t++) {
+            const int j = o[t];
+            if (cs[j] - ds > bd + PREDICT_SLACK * (cs[j] + ds)) break;
+            const double cb = cc_(best, j);
+            if (cb > 2.0 * bd + PREDICT_SLACK * cb) continue;
+            const double d = sqdist(x, C.row(j), D);
+            n++;
+            if (d < bsq || (d == bsq && j < best)) {
+                bsq = d;
+                bd = std::sqrt(d);
+                best = j;
+            }
+        }
+        *dist += n;
+        return best;
+    }
+
+private:
+    int K_;
+    Matrix<double> cc_;     // K×K, distâncias (não ao quadrado)
+    Matrix<int> order_;     // K×K, vizinhos de cada centróide por distância
+};
+
+// -----------------------------------------------------------------------------
+// predict_main: `predict <modelo.kmm> <dados.csv|.kmb> [--out=rotulos.bin]
+// [--index=auto|graph|none] [--chunk=linhas]`
+// -----------------------------------------------------------------------------
+inline int predict_main(const Options& opt, bool skip_header) {
+    if (opt.args.size() < 3) {
+        std::cerr << "Uso: predict <modelo.kmm> <dados.csv|.kmb> [--out=rotulos.bin] "
+                     "[--index=auto|graph|none] [--chunk=linhas]" << std::endl;
+        return 1;
+    }
+    const std::string index = opt.get("index", "auto");
+    if (index != "auto" && index != "graph" && index != "none") {
+        std::cerr << "Índice inválido: " << index << " (use auto, graph ou none)" << std::endl;
+        return 1;
+    }
+    const int chunk = opt.get_int("chunk", OOC_CHUNK_ROWS);
+    if (chunk < 1) {
+        std::cerr << "--chunk inválido: " << chunk << std::endl;
+        return 1;
+    }
+    const KMeansModel model = load_model(opt.args[1]);
+    const int K = model.K(), D = model.D();
+    RowSource src(opt.args[2], skip_header);
+    if (src.dim() != D) {
+        std::cerr << "Dimensão dos dados (" << src.dim() << ") difere da do modelo (" << D << ")" << std::endl;
+        return 1;
+    }
+    const std::string out_name = opt.get("out", opt.args[2] + ".pred");
+    std::ofstream out(out_name, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Erro ao criar arquivo de rótulos: " << out_name << std::endl;
+        return 1;
+    }
+
+    const Matrix<double>& C = model.centroids;
+    const DistanceKernel kern = select_kernel(D);
+    bool use_graph = index == "graph" || (index == "auto" && K >= PREDICT_INDEX_K);
+    bool probe = index == "auto" && use_graph;   // decide no primeiro pedaço qual é mais rápido
+    auto t_index = std::chrono::steady_clock::now();
+    std::unique_ptr<CentroidGraph> graph;
+    if (use_graph) graph = std::make_unique<CentroidGraph>(C, kern);
+    std::cout << "→ Modelo " << opt.args[1] << ": K=" << K << ", D=" << D
+              << (model.scaled() ? ", com escala" : "") << ", kernel " << kern.name;
+    if (graph) {
+        std::cout << ", grafo de centróides em "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - t_index).count() << " s";
+    }
+    std::cout << std::endl;
+
+    // Rotula as linhas [lo, hi) de X; devolve quantas distâncias calculou
+    std::vector<int32_t> labels(chunk);
+    auto assign = [&](const Matrix<double>& X, int lo, int hi, bool by_graph) {
+        long long dist = 0;
+        const int nb = (hi - lo + PREDICT_BLOCK - 1) / PREDICT_BLOCK;
+        #pragma omp parallel for schedule(dynamic, 4) reduction(+:dist)
+        for (int b = 0; b < nb; b++) {
+            const int i1 = std::min(hi, lo + (b + 1) * PREDICT_BLOCK);
+            int prev = 0;
+            for (int i = lo + b * PREDICT_BLOCK; i < i1; i++) {
+                if (by_graph) {
+                    prev = graph->nearest(X.row(i), C, prev, kern.sqdist, &dist);
+                } else {
+                    double best;
+                    prev = kern.nearest(X.row(i), C.data(), C.stride(), K, D, &best);
+                    dist += K;
+                }
+                labels[i] = prev;
+            }
+        }
+        return dist;
+    };
+
+    ChunkPrefetcher pf(src, chunk);
+    long long N = 0, dist = 0;
+    double assign_secs = 0.0;
+    const auto t0 = std::chrono::steady_clock::now();
+    pf.start_pass();
+    for (int cur = 0;; cur ^= 1) {
+        const int n = pf.wait(cur);
+        if (n == 0) break;
+        pf.request(cur ^ 1);   // lê o próximo enquanto este é atribuído
+        Matrix<double>& X = pf.buffer(cur);
+        const auto ta = std::chrono::steady_clock::now();
+        if (model.scaled()) {
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; i++) {
+                double* x = X.row(i);
+                for (int d = 0; d < D; d++) x[d] = (x[d] - model.offset[d]) / model.scale[d];
+            }
+        }
+        int lo = 0;
+        double discarded = 0.0;   // tempo do caminho descartado na amostra
+        if (probe) {
+            // Mesmas linhas pelos dois caminhos (os rótulos são iguais): fica o
+            // mais rápido, e só ele entra nas distâncias e no tempo totais
+            lo = std::min(n, PREDICT_PROBE);
+            double secs[2];
+            long long probe_dist[2];
+            for (int g = 0; g < 2; g++) {
+                const auto tp = std::chrono::steady_clock::now();
+                probe_dist[g] = assign(X, 0, lo, g == 1);
+                secs[g] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tp).count();
+            }
+            use_graph = secs[1] < secs[0];
+            probe = false;
+            dist += probe_dist[use_graph];
+            discarded = secs[!use_graph];
+            std::cout << "→ Amostra de " << lo << " linhas: grafo " << std::scientific << std::setprecision(3)
+                      << lo / secs[1] << " pontos/s, completa " << lo / secs[0] << " pontos/s"
+                      << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+        dist += assign(X, lo, n, use_graph);
+        assign_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - ta).count() - discarded;
+        out.write(reinterpret_cast<const char*>(labels.data()), static_cast<size_t>(n) * sizeof(int32_t));
+        N += n;
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Erro ao gravar " << out_name << std::endl;
+        return 1;
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "→ Atribuição " << (use_graph ? "pelo grafo de centróides" : "completa (K centróides por ponto)")
+              << std::endl;
+    std::cout << "→ " << N << " pontos rotulados em " << secs << " s: " << std::scientific
+              << std::setprecision(3) << N / secs << " pontos/s (só atribuição: " << N / assign_secs
+              << " pontos/s)" << std::defaultfloat << std::endl;
+    std::cout << "→ " << dist << " de " << N * K << " distâncias calculadas (" << std::fixed
+              << std::setprecision(1) << 100.0 * (N * K - dist) / std::max(1LL, N * K)
+              << "% evitadas)" << std::defaultfloat << std::endl;
+    std::cout << "→ Rótulos (int32) gravados em " << out_name << std::endl;
+    return 0;
+}
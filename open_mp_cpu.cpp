@@ -1,6 +1,23 @@
 // open_mp_cpu.cpp
 #include <bits/stdc++.h>
 #include <omp.h>
+#include "coreset.h"
+#include "dataset.h"
+#include "distance.h"
+#include "gemm_assign.h"
+#include "init.h"
+#include "ksweep.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#include "minibatch.h"
+#include "model.h"
+#include "options.h"
+#include "out_of_core.h"
+#include "packed.h"
+#include "pruned.h"
+#include "restarts.h"
+#include "server.h"
+#include "topology.h"
 using namespace std;
 
 // -----------------------------------------------------------------------------
@@ -9,6 +26,41 @@ using namespace std;
 // opcionalmente ignora o cabeçalho, e executa o algoritmo de K-Means em paralelo.
 // Ele permite configurar o número de clusters (K), o número máximo de iterações,
 // o arquivo de dados e o número de threads via defines ou argumentos de linha de comando.
+// Opções: --algo=lloyd|hamerly|elkan|yinyang (as variantes podam distâncias
+// com limites da desigualdade triangular e produzem os mesmos rótulos do lloyd).
+// --minibatch=B: K-Means em mini-lotes de B linhas lidas do arquivo mapeado,
+// sem carregar o dataset (max_iter passa a ser o número máximo de lotes).
+// --init=random|kmeans++|kmeans|| e --seed=S: inicialização dos centróides
+// (kmeans++ guloso e kmeans|| amostram D² em paralelo; determinísticos para a
+// mesma semente e número de threads).
+// --out-of-core: Lloyd exato lendo o arquivo em pedaços (--chunk=linhas) com
+// leitura antecipada em segundo plano; rótulos gravados em --labels-file.
+// --precision=f64|f32|compare: Lloyd com pontos em double ou float (somas em
+// double); compare roda os dois e mostra vazão e diferença de inércia.
+// --n-init=R: R reinícios (sementes seed..seed+R-1) no mesmo processo, com
+// corte dos que ficam para trás; imprime o melhor.
+// --profile=trace.json|trace.csv [--perf]: tempo de cada fase e iteração,
+// inércia e pontos que mudaram por iteração e, com --perf, contadores de
+// hardware (ciclos, instruções, falhas de LLC).
+// --update=full|delta: delta mantém as somas dos clusters entre iterações e
+// aplica só os pontos que mudaram de cluster (recomputação completa periódica).
+// --k-range=a:b [--k-lanes=L]: Lloyd para cada K de a a b numa só execução,
+// cada K partindo do K-1 com o pior cluster dividido; tabela de inércia,
+// silhueta simplificada, iterações e tempo (L faixas de K em paralelo).
+// --pack-binary: colunas só de 0/1 guardadas em bits ao lado das contínuas;
+// a distância soma a parte densa (SIMD) e um termo pelos bits ligados.
+// --coreset=M [--polish=P]: Lloyd ponderado sobre um coreset de M sorteios por
+// importância (mais P iterações sobre todos os dados); --coreset-compare roda
+// também o Lloyd completo e compara tempo e inércia.
+// --save-model=modelo.kmm: grava os centróides finais num modelo binário;
+// predict <modelo.kmm> <dados> [--out=rotulos.bin] [--index=auto|graph|none]
+// rotula pontos novos em paralelo (int32 por ponto) e mede pontos/s.
+// serve <arquivos...> [--socket=caminho] [--jobs=J]: processo persistente que
+// carrega os datasets uma vez e atende pedidos de agrupamento em JSON (ver
+// server.h).
+// --threads=N e --bind=spread|close|none: número de threads e fixação nas CPUs
+// dos nós NUMA; com mais de um nó os dados são copiados por first-touch e cada
+// nó lê a sua cópia dos centróides.
 // -----------------------------------------------------------------------------
 
 // ─────────── CONFIGURAÇÃO ───────────────────────────────────────────────────────
@@ -16,92 +68,63 @@ using namespace std;
 // DEFAULT_K:      Valor default de K (número de clusters)
 // DEFAULT_MAX_IT: Valor default de iterações máximas
 // SKIP_HEADER:    Define se a primeira linha (header) deve ser ignorada
-// NUM_THREADS:    Número de threads a serem usadas pelo OpenMP
+// NUM_THREADS:    Número de threads do OpenMP (0 = OMP_NUM_THREADS ou todas as CPUs)
+// VERIFY_CHECKSUM: Confere o checksum ao abrir um arquivo binário (.kmb)
+// GEMM_K_THRESHOLD: A partir deste K a atribuição usa o caminho GEMM em blocos
 // ────────────────────────────────────────────────────────────────────────────────
 #define DATA_FILE       "covtype.csv"
 #define DEFAULT_K       10
 #define DEFAULT_MAX_IT  150
 #define SKIP_HEADER     true
-#define NUM_THREADS     32   // Ajuste aqui o número de threads para paralelização
+#define NUM_THREADS     0    // Ajuste aqui (ou com --threads=N) o número de threads
+#define VERIFY_CHECKSUM false
+#define GEMM_K_THRESHOLD 64
 
 // -----------------------------------------------------------------------------
-// Função: load_csv
-// Objetivo: Lê um arquivo CSV numérico e retorna um vetor de amostras (vetores de double).
-// Parâmetro: filename - nome do arquivo CSV a ser carregado
-// Detalhes:
-//  1. Abre o arquivo e verifica erro de abertura
-//  2. Se SKIP_HEADER for true, pula a primeira linha
-//  3. Para cada linha:
-//     - Remove caracteres de nova linha e vírgulas finais
-//     - Divide a linha em tokens separadas por vírgula
-//     - Remove espaços em branco em ambos extremos de cada token
-//     - Converte cada token para double (ignora tokens não numéricos)
-//     - Remove a última coluna (assumida como rótulo)
-//     - Adiciona o vetor de valores à estrutura de dados
-// Retorno: vetor de vetores de double, cada um representando uma amostra
-vector<vector<double>> load_csv(const string& filename) {
-    ifstream in(filename);
-    if (!in) {
-        cerr << "Erro ao abrir arquivo: " << filename << endl;
-        exit(1);
-    }
-    vector<vector<double>> data;
-    string line;
-#if SKIP_HEADER
-    // Se configurado, pula a primeira linha de cabeçalho
-    if (!getline(in, line)) {
-        cerr << "Arquivo vazio ou sem header para pular" << endl;
-        exit(1);
-    }
-#endif
-    // Processa cada linha restante
-    while (getline(in, line)) {
-        // Remove retornos de carro e vírgulas finais
-        while (!line.empty() && (line.back()=='\r' || line.back()=='\n' || line.back()==','))
-            line.pop_back();
-        if (line.empty()) continue;
-
-        stringstream ss(line);
-        vector<double> row;
-        string cell;
-        // Para cada célula separada por vírgula
-        while (getline(ss, cell, ',')) {
-            // Remove espaços em branco no início
-            cell.erase(cell.begin(),
-                       find_if(cell.begin(), cell.end(),
-                               [](unsigned char c){ return !isspace(c); }));
-            // Remove espaços em branco no fim
-            cell.erase(find_if(cell.rbegin(), cell.rend(),
-                               [](unsigned char c){ return !isspace(c); }).base(),
-                       cell.end());
-            try {
-                row.push_back(stod(cell)); // Converte string para double
-            } catch (invalid_argument&) {
-                // Ignora tokens não numéricos
-            }
-        }
-        // Remove a última coluna (rótulo), se existir
-        if (!row.empty()) row.pop_back();
-        // Adiciona a amostra ao conjunto de dados
-        if (!row.empty()) data.emplace_back(move(row));
-    }
-    return data;
+// Imprime os centróides finais e o tamanho de cada cluster
+static void print_clusters(const Matrix<double>& centroids, const vector<long long>& cluster_size) {
+    const int K = centroids.rows(), D = centroids.cols();
+    cout << fixed << setprecision(4);
+    for (int k = 0; k < K; k++) {
+        cout << "Centróide " << k << ": ";
+        for (int d = 0; d < D; d++) {
+            cout << centroids(k, d) << " ";
+        }
+        cout << endl;
+    }
+    for (int k = 0; k < K; k++) {
+        cout << "Cluster " << k << " tem " << cluster_size[k] << " pontos" << endl;
+    }
+}
+
+// Com --save-model=arquivo.kmm grava os centróides finais (modo predict)
+static void save_model_opt(const Options& opt, const Matrix<double>& centroids, long long n_train) {
+    if (!opt.has("save-model")) return;
+    KMeansModel m;
+    m.centroids = centroids;
+    m.n_train = n_train;
+    const string path = opt.get("save-model", "model.kmm");
+    save_model(m, path);
+    cout << "→ Modelo (K=" << m.K() << ", D=" << m.D() << ") gravado em " << path << endl;
 }
 
 // -----------------------------------------------------------------------------
-// Função: euclid
-// Objetivo: Calcula a distância Euclidiana entre dois vetores de mesma dimensão
-// Parâmetros:
-//  a - primeiro vetor
-//  b - segundo vetor
-// Retorno: distância Euclidiana (sqrt da soma dos quadrados das diferenças)
-double euclid(const vector<double>& a, const vector<double>& b) {
-    double sum = 0.0;
-    for (size_t i = 0; i < a.size(); i++) {
-        double diff = a[i] - b[i];
-        sum += diff * diff;
-    }
-    return sqrt(sum);
+// Lloyd em float: converte pontos e centróides, acumula as somas em double e
+// devolve centróides em double. secs recebe só o tempo do laço.
+static KMeansResult lloyd_f32(const Matrix<double>& X, int N, const Matrix<double>& C0,
+                              int max_iter, double& secs) {
+    const int D = X.cols();
+    Matrix<float> Xf = matrix_cast<float>(X);
+    DistanceKernelT<float> kernf = select_kernel<float>(D);
+    auto t0 = chrono::steady_clock::now();
+    KMeansResult res = kmeans_lloyd<float, double>(Xf, N, matrix_cast<float>(C0), max_iter, kernf);
+    secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return res;
+}
+
+// Vazão em pontos·iteração/s (conta também a passada que detecta a convergência)
+static double throughput(const KMeansResult& res, int N, double secs) {
+    return (double)N * (res.iterations + (res.converged ? 1 : 0)) / secs;
 }
 
 // -----------------------------------------------------------------------------
@@ -109,25 +132,221 @@ double euclid(const vector<double>& a, const vector<double>& b) {
 // Descrição: Configura o ambiente OpenMP, carrega dados, inicializa centróides,
 // executa o loop principal do K-Means e imprime os resultados.
 int main(int argc, char* argv[]) {
-    // Configura o número de threads para o OpenMP
-    omp_set_num_threads(NUM_THREADS);
+    // Processa argumentos de linha de comando: K, iteracoes e arquivo (.csv ou .kmb)
+    // e as opções --chave=valor
+    Options opt = parse_options(argc, argv);
+
+    // Configura o número de threads para o OpenMP e as fixa nos nós NUMA
+    int threads = opt.get_int("threads", NUM_THREADS);
+    if (threads > 0) omp_set_num_threads(threads);
     cout << "Número de threads: " << omp_get_max_threads() << endl;
+    string bind = opt.get("bind", "spread");
+    if (bind != "spread" && bind != "close" && bind != "none") {
+        cerr << "Fixação inválida: " << bind << " (use spread, close ou none)" << endl;
+        return 1;
+    }
+    Topology topo = read_topology();
+    print_topology(cout, topo, bind_threads(topo, bind));
+
+    // Modo servidor: datasets e threads ficam prontos entre os pedidos
+    if (argc >= 2 && string(argv[1]) == "serve") {
+        if (opt.has("profile")) {
+            cerr << "--profile não é suportado no modo serve" << endl;
+            return 1;
+        }
+        return serve_main(opt, SKIP_HEADER, VERIFY_CHECKSUM, DEFAULT_K, DEFAULT_MAX_IT);
+    }
+    if (opt.has("profile")) {
+        string trace = opt.get("profile", "");
+        profiler().enable(trace == "1" ? "profile.json" : trace, opt.has("perf"));
+    }
+
+    // Modo de conversão CSV → binário: convert <entrada.csv> <saida.kmb>
+    if (argc >= 2 && string(argv[1]) == "convert")
+        return convert_main(argc, argv, SKIP_HEADER);
+    // Rótulos de pontos novos com um modelo salvo: predict <modelo.kmm> <dados>
+    if (argc >= 2 && string(argv[1]) == "predict")
+        return predict_main(opt, SKIP_HEADER);
+
+    int K = opt.arg_int(0, DEFAULT_K);
+    int max_iter = opt.arg_int(1, DEFAULT_MAX_IT);
+    string filename = opt.arg(2, DATA_FILE);
+    string algo = opt.get("algo", "lloyd");
+    string init = opt.get("init", "random");
+    uint64_t seed = opt.get_int("seed", 1234);   // semente fixa para reprodutibilidade
+    if (init != "random" && init != "kmeans++" && init != "kmeans||") {
+        cerr << "Inicialização inválida: " << init << " (use random, kmeans++ ou kmeans||)" << endl;
+        return 1;
+    }
+    if (algo != "lloyd" && algo != "hamerly" && algo != "elkan" && algo != "yinyang") {
+        cerr << "Algoritmo inválido: " << algo << " (use lloyd, hamerly, elkan ou yinyang)" << endl;
+        return 1;
+    }
+    string precision = opt.get("precision", "f64");
+    if (precision != "f64" && precision != "f32" && precision != "compare") {
+        cerr << "Precisão inválida: " << precision << " (use f64, f32 ou compare)" << endl;
+        return 1;
+    }
+    if (precision != "f64" && algo != "lloyd") {
+        cerr << "--precision=" << precision << " só está disponível com --algo=lloyd" << endl;
+        return 1;
+    }
+    int n_init = opt.get_int("n-init", 1);
+    if (n_init < 1 || (n_init > 1 && (algo != "lloyd" || precision != "f64"))) {
+        cerr << "--n-init=" << n_init << " inválido (R >= 1; R > 1 só com lloyd em f64)" << endl;
+        return 1;
+    }
+    string update = opt.get("update", "full");
+    if (update != "full" && update != "delta") {
+        cerr << "Atualização inválida: " << update << " (use full ou delta)" << endl;
+        return 1;
+    }
+    const bool delta = update == "delta";
+    const bool pack = opt.has("pack-binary");
+    if (pack && (algo != "lloyd" || precision != "f64" || n_init > 1 || delta || opt.has("minibatch")
+                 || opt.has("out-of-core") || opt.has("k-range"))) {
+        cerr << "--pack-binary só está disponível com lloyd em f64 e os dados em memória "
+             << "(sem --n-init, --update=delta ou --k-range)" << endl;
+        return 1;
+    }
+    const bool coreset = opt.has("coreset");
+    if (coreset && (algo != "lloyd" || precision != "f64" || n_init > 1 || delta || pack
+                    || opt.has("minibatch") || opt.has("out-of-core") || opt.has("k-range"))) {
+        cerr << "--coreset só está disponível com lloyd em f64 e os dados em memória "
+             << "(sem --n-init, --update=delta, --pack-binary ou --k-range)" << endl;
+        return 1;
+    }
+    if (delta && (precision != "f64" || n_init > 1 || opt.has("minibatch") || opt.has("out-of-core"))) {
+        cerr << "--update=delta só está disponível em f64, com os dados em memória e sem --n-init" << endl;
+        return 1;
+    }
 
-    // Processa argumentos de linha de comando: K, iteracoes e arquivo
-    int K = (argc >= 2 ? stoi(argv[1]) : DEFAULT_K);
-    int max_iter = (argc >= 3 ? stoi(argv[2]) : DEFAULT_MAX_IT);
-    string filename = (argc >= 4 ? argv[3] : DATA_FILE);
+    // Mini-lotes: o arquivo só é mapeado e amostrado, nunca carregado inteiro
+    if (opt.has("minibatch")) {
+        int B = opt.get_int("minibatch", 1024);
+        RowSource src(filename, SKIP_HEADER);
+        DistanceKernel kern = select_kernel(src.dim());
+        cout << "→ Mini-lotes de " << B << " linhas de " << filename << " (dim=" << src.dim()
+             << "), kernel " << kern.name << endl;
+        if (K <= 0 || B <= 0 || (src.rows() >= 0 && K > src.rows())) {
+            cerr << "Valor de K ou do lote inválido: K=" << K << " B=" << B << endl;
+            return 1;
+        }
+        auto t0 = chrono::steady_clock::now();
+        MiniBatchResult mb = kmeans_minibatch(src, K, B, max_iter, kern, seed);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "→ " << mb.batches << " lotes" << (mb.early_stop ? " (parada pela inércia suavizada)" : "")
+             << ", inércia média suavizada " << mb.smoothed_inertia << ", inércia total "
+             << mb.inertia << " sobre " << mb.rows << " linhas, " << secs << " s" << endl;
+        save_model_opt(opt, mb.centroids, mb.rows);
+        print_clusters(mb.centroids, mb.cluster_size);
+        return 0;
+    }
+
+    // Fora da memória: mesmo resultado do Lloyd, lendo o arquivo a cada iteração
+    if (opt.has("out-of-core")) {
+        RowSource src(filename, SKIP_HEADER);
+        const int D = src.dim();
+        const long long N = src.count_rows();
+        if (K <= 0 || K > N) {
+            cerr << "Valor de K inválido: " << K << endl;
+            return 1;
+        }
+        DistanceKernel kern = select_kernel(D);
+        Matrix<double> centroids(K, D);
+        src.gather(init_indices(N, K, seed), centroids);
+        LabelFile lf(opt.get("labels-file", filename + ".labels"), N, K);
+        const int chunk = opt.get_int("chunk", OOC_CHUNK_ROWS);
+        cout << "→ Fora da memória: " << N << " amostras de " << filename << " (dim=" << D
+             << "), pedaços de " << chunk << " linhas, kernel " << kern.name
+             << ", rótulos em " << lf.path() << " (" << lf.width() << " byte(s) cada)" << endl;
+        OutOfCoreResult oc = kmeans_out_of_core(src, N, std::move(centroids), max_iter, kern, chunk, lf,
+                                                K >= GEMM_K_THRESHOLD);
+        double total = 0, wait = 0;
+        for (size_t it = 0; it < oc.iter_secs.size(); it++) {
+            cout << "  iteração " << it << ": " << setprecision(3) << fixed << oc.iter_secs[it]
+                 << " s, espera de E/S " << oc.io_wait_secs[it] << " s" << endl;
+            total += oc.iter_secs[it];
+            wait += oc.io_wait_secs[it];
+        }
+        cout << "→ Total " << total << " s, espera de E/S " << wait << " s ("
+             << setprecision(1) << 100.0 * wait / max(total, 1e-9) << "%)" << endl;
+        if (oc.converged) {
+            cout << "Convergiu em " << oc.iterations << " iterações." << endl;
+        }
+        save_model_opt(opt, oc.centroids, N);
+        print_clusters(oc.centroids, oc.cluster_size);
+        return 0;
+    }
 
-    // Carrega os dados do CSV
-    auto data = load_csv(filename);
-    int N = static_cast<int>(data.size());
+    // Carrega os dados: .kmb é mapeado sem cópia, CSV é convertido em paralelo
+    Dataset ds = [&] {
+        ProfileScope s("load");
+        return load_dataset(filename, SKIP_HEADER, VERIFY_CHECKSUM);
+    }();
+    int N = ds.N;
     if (N == 0) {
         cerr << "Nenhuma amostra carregada de " << filename << endl;
         return 1;
     }
-    int D = static_cast<int>(data[0].size());
+    int D = ds.D;
     cout << "→ Carreguei " << N << " amostras de " << filename
          << " (dim=" << D << ")" << endl;
+    // Threads em mais de um nó: cada bloco de linhas vai para a memória do nó
+    // da thread que o processa (o loader e o mmap deixam tudo num nó só)
+    if (thread_placement().nodes > 1) {
+        auto t_place = chrono::steady_clock::now();
+        ds.X = first_touch_copy(ds.X, REDUCE_BLOCK);
+        cout << "→ First-touch: dados repartidos entre " << thread_placement().nodes << " nós em "
+             << chrono::duration<double>(chrono::steady_clock::now() - t_place).count() << " s" << endl;
+    }
+
+    // Seleciona o kernel de distância ao quadrado (AVX-512/AVX2/escalar, D fixo
+    // quando houver instância); as variantes com poda tiram a raiz para usar os limites
+    DistanceKernel kern = select_kernel(D);
+    cout << "→ Kernel de distância: " << kern.name << endl;
+
+    // Varredura de K: a tabela substitui a saída de centróides
+    if (opt.has("k-range")) {
+        const string range = opt.get("k-range", "");
+        const size_t colon = range.find(':');
+        int a = 0, b = 0;
+        try {
+            a = stoi(range.substr(0, colon));
+            b = colon == string::npos ? a : stoi(range.substr(colon + 1));
+        } catch (const exception&) {
+            a = b = 0;
+        }
+        const int lanes = opt.get_int("k-lanes", 1);
+        if (a < 1 || b < a || b > N || lanes < 1) {
+            cerr << "--k-range=" << range << " inválido (use a:b com 1 <= a <= b <= " << N
+                 << ", --k-lanes >= 1)" << endl;
+            return 1;
+        }
+        if (algo != "lloyd" || precision != "f64" || n_init > 1 || delta) {
+            cerr << "--k-range só está disponível com lloyd em f64, sem --n-init nem --update=delta" << endl;
+            return 1;
+        }
+        auto t_sweep = chrono::steady_clock::now();
+        vector<KSweepRow> rows = kmeans_sweep(ds.X, N, a, b, lanes, max_iter, kern, init, seed);
+        int best = 0;
+        for (size_t r = 0; r < rows.size(); r++)
+            if (rows[r].K > 1 && (rows[best].K == 1 || rows[r].silhouette > rows[best].silhouette)) best = r;
+        cout << "     K        inércia   queda  silhueta  iterações  tempo (s)" << endl;
+        for (size_t r = 0; r < rows.size(); r++) {
+            const KSweepRow& row = rows[r];
+            cout << setw(6) << row.K << "  " << scientific << setprecision(6) << row.inertia << fixed;
+            if (r > 0) cout << "  " << setw(5) << setprecision(1) << 100.0 * (1.0 - row.inertia / rows[r - 1].inertia) << "%";
+            else cout << "       ";
+            cout << "  " << setw(8) << setprecision(4) << row.silhouette << "  " << setw(9) << row.iterations
+                 << (row.converged ? " " : "+") << " " << setw(9) << setprecision(3) << row.secs
+                 << (int(r) == best && row.K > 1 ? "  ← maior silhueta" : "") << endl;
+        }
+        cout << defaultfloat << setprecision(6) << "→ Varredura K=" << a << ".." << b << " (" << min(lanes, b - a + 1)
+             << " faixa(s)) em " << chrono::duration<double>(chrono::steady_clock::now() - t_sweep).count()
+             << " s" << endl;
+        return 0;
+    }
 
     // Valida valor de K
     if (K <= 0 || K > N) {
@@ -135,97 +354,191 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    // Inicializa centróides escolhendo amostras aleatórias distintas
-    vector<vector<double>> centroids(K, vector<double>(D));
-    mt19937_64 rng(1234);  // Semente fixa para reprodutibilidade
-    uniform_int_distribution<int> pick(0, N-1);
-    unordered_set<int> used_indices;
-    for (int k = 0; k < K; ) {
-        int idx = pick(rng);
-        if (used_indices.insert(idx).second) {
-            centroids[k++] = data[idx];
-        }
-    }
-
-    // Vetor de rótulos para cada amostra
-    vector<int> labels(N, -1);
-    // Loop principal do K-Means
-    for (int iter = 0; iter < max_iter; iter++) {
-        bool changed = false;
-        // Etapa 1: Atribuição de cada ponto ao centróide mais próximo (em paralelo)
-        #pragma omp parallel for schedule(static)
-        for (int i = 0; i < N; i++) {
-            double best_dist = numeric_limits<double>::infinity();
-            int best_k = 0;
-            for (int k = 0; k < K; k++) {
-                double dist = euclid(data[i], centroids[k]);
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best_k = k;
-                }
-            }
-            if (labels[i] != best_k) {
-                labels[i] = best_k;
-                changed = true;
-            }
-        }
-        // Se não houve mudança nos rótulos, considera convergido
-        if (!changed) {
-            cout << "Convergiu em " << iter << " iterações." << endl;
-            break;
-        }
-        // Etapa 2: Recalcula os centróides como média dos pontos atribuídos
-        vector<vector<double>> sum(K, vector<double>(D, 0.0));
-        vector<int> count(K, 0);
-        #pragma omp parallel
-        {
-            // Estruturas locais por thread para evitar contenção
-            vector<vector<double>> local_sum(K, vector<double>(D, 0.0));
-            vector<int> local_count(K, 0);
-            #pragma omp for nowait
-            for (int i = 0; i < N; i++) {
-                int c = labels[i];
-                local_count[c]++;
-                for (int d = 0; d < D; d++) {
-                    local_sum[c][d] += data[i][d];
-                }
-            }
-            // Região crítica para agregar resultados locais
-            #pragma omp critical
-            {
-                for (int k = 0; k < K; k++) {
-                    count[k] += local_count[k];
-                    for (int d = 0; d < D; d++) {
-                        sum[k][d] += local_sum[k][d];
-                    }
-                }
-            }
-        }
-        // Atualiza cada centróide dividindo pela quantidade de pontos
-        for (int k = 0; k < K; k++) {
-            if (count[k] == 0) continue; // evita divisão por zero
-            for (int d = 0; d < D; d++) {
-                centroids[k][d] = sum[k][d] / count[k];
-            }
+    // Coreset: K-Means ponderado sobre M pontos sorteados por importância e,
+    // com --coreset-compare, o Lloyd sobre todos os dados a partir de --init
+    if (coreset) {
+        const int M = opt.get_int("coreset", 0);
+        const int polish = opt.get_int("polish", 0);
+        if (M < K || polish < 0) {
+            cerr << "--coreset=" << M << " inválido (use M >= K e --polish >= 0)" << endl;
+            return 1;
+        }
+        auto t0 = chrono::steady_clock::now();
+        Coreset cs = build_coreset(ds.X, N, M, kern, seed);
+        const double build_secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if (cs.size() < K) {
+            cerr << "O coreset tem só " << cs.size() << " pontos distintos para K=" << K << endl;
+            return 1;
+        }
+        auto t1 = chrono::steady_clock::now();
+        KMeansResult cr = kmeans_weighted(cs, coreset_init(cs, K, kern, seed), max_iter, kern);
+        const double weighted_secs = chrono::duration<double>(chrono::steady_clock::now() - t1).count();
+        auto t2 = chrono::steady_clock::now();
+        KMeansResult pr;
+        if (polish > 0) pr = kmeans_lloyd(ds.X, N, cr.centroids, polish, kern);
+        const double polish_secs = chrono::duration<double>(chrono::steady_clock::now() - t2).count();
+        const double coreset_secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        Matrix<double> C = polish > 0 ? std::move(pr.centroids) : std::move(cr.centroids);
+
+        // Inércia sobre todos os dados; os rótulos dão os tamanhos dos clusters
+        vector<int> labels(N);
+        vector<double> ev = sweep_detail::evaluate(ds.X, N, C, kern, labels);
+        const double coreset_inertia = accumulate(ev.begin(), ev.end() - 1, 0.0);
+
+        cout << "→ Coreset: " << cs.size() << " pontos distintos de " << M << " sorteios (peso total "
+             << setprecision(4) << accumulate(cs.w.begin(), cs.w.end(), 0.0) << ", N=" << N << ") em "
+             << build_secs << " s" << endl;
+        cout << "→ Lloyd ponderado: " << cr.iterations << " iterações" << (cr.converged ? " (convergiu)" : "")
+             << " em " << weighted_secs << " s";
+        if (polish > 0) cout << "; polimento: " << pr.iterations << " iterações sobre os dados em " << polish_secs << " s";
+        cout << endl;
+        if (opt.has("coreset-compare")) {
+            auto t3 = chrono::steady_clock::now();
+            KMeansResult fr = kmeans_lloyd(ds.X, N, init_centroids(init, ds.X, N, K, kern, seed), max_iter, kern);
+            const double full_secs = chrono::duration<double>(chrono::steady_clock::now() - t3).count();
+            vector<int> full_labels(N);
+            ev = sweep_detail::evaluate(ds.X, N, fr.centroids, kern, full_labels);
+            const double full_inertia = accumulate(ev.begin(), ev.end() - 1, 0.0);
+            cout << "→ Lloyd completo (--init=" << init << "): " << fr.iterations << " iterações"
+                 << (fr.converged ? " (convergiu)" : "") << " em " << full_secs << " s" << endl;
+            cout << "→ Coreset " << coreset_secs << " s vs completo " << full_secs << " s: "
+                 << setprecision(3) << full_secs / coreset_secs << "x; inércia " << scientific << setprecision(6)
+                 << coreset_inertia << " vs " << full_inertia << defaultfloat << setprecision(3) << " ("
+                 << showpos << 100.0 * (coreset_inertia - full_inertia) / full_inertia << noshowpos << "%)" << endl;
+        } else {
+            cout << "→ Total do coreset: " << coreset_secs << " s; inércia sobre todos os dados "
+                 << scientific << setprecision(6) << coreset_inertia << defaultfloat << endl;
+        }
+        vector<long long> cluster_size(K, 0);
+        for (int label : labels) cluster_size[label]++;
+        save_model_opt(opt, C, N);
+        print_clusters(C, cluster_size);
+        return 0;
+    }
+
+    // Vários reinícios: todos sobre o mesmo ds.X, o melhor vira o resultado
+    if (n_init > 1) {
+        auto t_multi = chrono::steady_clock::now();
+        MultiRestartResult mr = [&] {
+            ProfileScope s("run");
+            return kmeans_restarts(ds.X, N, K, n_init, max_iter, kern, init, seed);
+        }();
+        for (int r = 0; r < n_init; r++) {
+            const RestartRun& run = mr.runs[r];
+            cout << "→ Reinício " << r << " (semente " << run.seed << "): inércia "
+                 << scientific << setprecision(6) << run.inertia << defaultfloat << ", "
+                 << run.iterations << " iterações";
+            if (run.cut_at >= 0) cout << ", cortado na iteração " << run.cut_at;
+            else if (run.converged) cout << ", convergiu";
+            cout << (r == mr.best_index ? "  ← melhor" : "") << endl;
         }
+        cout << "→ " << n_init << " reinícios em "
+             << chrono::duration<double>(chrono::steady_clock::now() - t_multi).count() << " s" << endl;
+        if (mr.best.converged) {
+            cout << "Convergiu em " << mr.best.iterations << " iterações." << endl;
+        }
+        vector<long long> cluster_size(K, 0);
+        for (int label : mr.best.labels) cluster_size[label]++;
+        save_model_opt(opt, mr.best.centroids, N);
+        print_clusters(mr.best.centroids, cluster_size);
+        return 0;
     }
 
-    // Saída final dos centróides e tamanhos dos clusters
-    cout << fixed << setprecision(4);
-    for (int k = 0; k < K; k++) {
-        cout << "Centróide " << k << ": ";
-        for (double v : centroids[k]) {
-            cout << v << " ";
+    // Inicializa centróides: amostras aleatórias distintas, kmeans++ ou kmeans||
+    // (Matrix: uma única alocação alinhada, linhas com padding até 64 bytes)
+    auto t_init = chrono::steady_clock::now();
+    Matrix<double> centroids = [&] {
+        ProfileScope s("init");
+        return init_centroids(init, ds.X, N, K, kern, seed);
+    }();
+    cout << "→ Inicialização " << init << " em "
+         << chrono::duration<double>(chrono::steady_clock::now() - t_init).count() << " s" << endl;
+    // Colunas binárias em bits: a cópia empacotada substitui os dados densos
+    PackedData packed;
+    if (pack) {
+        auto t_pack = chrono::steady_clock::now();
+        packed = pack_binary(ds.X, N);
+        cout << "→ Colunas binárias: " << packed.B << " de " << D << " em bits, linha de "
+             << packed.row_bytes() << " bytes (densa: " << ds.stride() * sizeof(double) << ") em "
+             << chrono::duration<double>(chrono::steady_clock::now() - t_pack).count() << " s" << endl;
+        ds = Dataset();
+    }
+    auto t_run = chrono::steady_clock::now();
+
+    // Executa o algoritmo escolhido
+    auto run_scope = make_unique<ProfileScope>("run");
+    KMeansResult res;
+    Matrix<double> initial;                 // cópia para a rodada em float do compare
+    if (precision == "compare") initial = centroids;
+    if (pack) {
+        res = kmeans_lloyd_packed(packed, std::move(centroids), max_iter);
+    } else if (algo != "lloyd") {
+        res = kmeans_pruned(algo, ds.X, N, std::move(centroids), max_iter, kern, delta);
+    } else if (precision == "f32") {
+        cout << "→ Precisão: pontos em float (" << kern.name << "/f32), somas em double" << endl;
+        double secs;
+        res = lloyd_f32(ds.X, N, centroids, max_iter, secs);
+    } else {
+        // Para K grande a atribuição vira um GEMM em blocos (||x||² - 2x·c + ||c||²)
+        unique_ptr<GemmAssigner> gemm;
+        if (K >= GEMM_K_THRESHOLD) {
+            gemm = make_unique<GemmAssigner>(ds.X, N, D);
+            cout << "→ Atribuição: GEMM em blocos (" << gemm->name() << ", K >= "
+                 << GEMM_K_THRESHOLD << ")" << endl;
         }
-        cout << endl;
+        res = kmeans_lloyd(ds.X, N, std::move(centroids), max_iter, kern, gemm.get(), delta);
+    }
+    run_scope.reset();
+    if (res.converged) {
+        cout << "Convergiu em " << res.iterations << " iterações." << endl;
+    }
+    const double run_secs = chrono::duration<double>(chrono::steady_clock::now() - t_run).count();
+    cout << "→ " << res.iterations << " iterações em " << run_secs << " s" << endl;
+    if (precision == "f32") {
+        cout << "→ f32: " << scientific << setprecision(3) << throughput(res, N, run_secs)
+             << " pontos·iteração/s, inércia " << inertia(ds.X, N, res.labels, res.centroids, kern)
+             << defaultfloat << endl;
+    } else if (precision == "compare") {
+        // Mesmo ponto de partida, agora em float; a inércia é sempre medida em double
+        double f32_secs;
+        KMeansResult rf = lloyd_f32(ds.X, N, initial, max_iter, f32_secs);
+        const double in64 = inertia(ds.X, N, res.labels, res.centroids, kern);
+        const double in32 = inertia(ds.X, N, rf.labels, rf.centroids, kern);
+        const double tp64 = throughput(res, N, run_secs), tp32 = throughput(rf, N, f32_secs);
+        long long moved = 0;
+        for (int i = 0; i < N; i++) moved += (res.labels[i] != rf.labels[i]);
+        cout << scientific << setprecision(3)
+             << "→ f64: " << res.iterations << " iterações, " << tp64
+             << " pontos·iteração/s, inércia " << in64 << endl
+             << "→ f32: " << rf.iterations << " iterações, " << tp32
+             << " pontos·iteração/s, inércia " << in32 << endl
+             << defaultfloat << setprecision(3)
+             << "→ f32/f64: vazão " << tp32 / tp64 << "x, inércia "
+             << showpos << 100.0 * (in32 - in64) / in64 << noshowpos << "%, "
+             << moved << " rótulos diferentes" << endl;
+    }
+    if (algo != "lloyd") {
+        cout << "→ " << algo << ": " << res.dist_computed << " de " << res.dist_full
+             << " distâncias calculadas (" << setprecision(1) << fixed
+             << 100.0 * (res.dist_full - res.dist_computed) / res.dist_full
+             << "% evitadas";
+        if (res.dist_centroid > 0) cout << ", +" << res.dist_centroid << " entre centróides";
+        cout << ")" << endl;
+    }
+    if (delta) {
+        cout << "→ Atualização incremental: " << res.delta_updates << " de " << res.iterations
+             << " atualizações por deltas (" << res.moved << " pontos movidos)" << endl;
     }
-    vector<int> cluster_size(K, 0);
+    centroids = std::move(res.centroids);
+    const vector<int>& labels = res.labels;
+
+    // Saída final dos centróides e tamanhos dos clusters
+    vector<long long> cluster_size(K, 0);
     for (int label : labels) {
         cluster_size[label]++;
     }
-    for (int k = 0; k < K; k++) {
-        cout << "Cluster " << k << " tem " << cluster_size[k] << " pontos" << endl;
-    }
+    save_model_opt(opt, centroids, N);
+    print_clusters(centroids, cluster_size);
 
     return 0;
 }
\ No newline at end of file
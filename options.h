@@ -0,0 +1,50 @@
+// options.h
+#pragma once
+#include <bits/stdc++.h>
+
+// -----------------------------------------------------------------------------
+// Opções de linha de comando. Os argumentos posicionais continuam os mesmos
+// ([K] [max_iter] [arquivo]); opções extras vêm como --chave=valor (ou só
+// --chave, que vale "1") e podem aparecer em qualquer posição.
+// -----------------------------------------------------------------------------
+
+struct Options {
+    std::vector<std::string> args;             // argumentos posicionais
+    std::map<std::string, std::string> flags;  // --chave=valor
+
+    bool has(const std::string& key) const { return flags.count(key) > 0; }
+
+    std::string get(const std::string& key, const std::string& def) const {
+        auto it = flags.find(key);
+        return it == flags.end() ? def : it->second;
+    }
+
+    int get_int(const std::string& key, int def) const {
+        auto it = flags.find(key);
+        return it == flags.end() ? def : std::stoi(it->second);
+    }
+
+    double get_double(const std::string& key, double def) const {
+        auto it = flags.find(key);
+        return it == flags.end() ? def : std::stod(it->second);
+    }
+
+    // i-ésimo argumento posicional ou def
+    std::string arg(size_t i, const std::string& def) const { return i < args.size() ? args[i] : def; }
+    int arg_int(size_t i, int def) const { return i < args.size() ? std::stoi(args[i]) : def; }
+};
+
+inline Options parse_options(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a.size() > 2 && a.compare(0, 2, "--") == 0) {
+            size_t eq = a.find('=');
+            if (eq == std::string::npos) opt.flags[a.substr(2)] = "1";
+            else opt.flags[a.substr(2, eq - 2)] = a.substr(eq + 1);
+        } else {
+            opt.args.push_back(a);
+        }
+    }
+    return opt;
+}
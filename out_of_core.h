@@ -0,0 +1,251 @@
+// out_of_core.h
+#pragma once
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "distance.h"
+#include "gemm_assign.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#include "row_source.h"
+
+// -----------------------------------------------------------------------------
+// Lloyd exato fora da memória.
+//
+// Cada iteração percorre o arquivo em pedaços de OOC_CHUNK_ROWS linhas. Uma
+// thread de E/S lê o pedaço i+1 para o segundo buffer enquanto o time OpenMP
+// atribui e acumula o pedaço i (buffer duplo). Os rótulos não ficam em
+// memória: vão para um arquivo compacto (1, 2 ou 4 bytes por ponto, conforme
+// K), lido e regravado pedaço a pedaço.
+//
+// A atribuição usa o mesmo kernel (ou o mesmo GEMM) do caminho em memória e a
+// soma dos centróides usa CentroidSums (na mesma passada, sem GEMM) com
+// pedaços múltiplos de REDUCE_BLOCK, então centróides e rótulos saem bit a bit iguais aos de kmeans_lloyd.
+// Memória: dois pedaços + O(K·D), independente de N.
+// -----------------------------------------------------------------------------
+
+#define OOC_CHUNK_ROWS (16 * REDUCE_BLOCK)   // linhas por pedaço (padrão)
+
+// -----------------------------------------------------------------------------
+// LabelFile: vetor de rótulos em disco com a menor largura que cabe K
+// (o maior valor da largura marca "sem rótulo").
+// -----------------------------------------------------------------------------
+class LabelFile {
+public:
+    LabelFile(const std::string& path, long long n, int K) : path_(path) {
+        width_ = K < 0xFF ? 1 : K < 0xFFFF ? 2 : 4;
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0 || ftruncate(fd_, n * width_) != 0) {
+            std::cerr << "Erro ao criar arquivo de rótulos: " << path << std::endl;
+            exit(1);
+        }
+    }
+    LabelFile(const LabelFile&) = delete;
+    LabelFile& operator=(const LabelFile&) = delete;
+    ~LabelFile() { if (fd_ >= 0) close(fd_); }
+
+    int width() const { return width_; }
+    const std::string& path() const { return path_; }
+
+    void read(long long first, int n, int* out) {
+        buf_.resize((size_t)n * width_);
+        if (pread(fd_, buf_.data(), buf_.size(), first * width_) != (ssize_t)buf_.size()) {
+            std::cerr << "Erro ao ler rótulos de " << path_ << std::endl;
+            exit(1);
+        }
+        for (int i = 0; i < n; i++) {
+            uint32_t v = width_ == 1 ? buf_[i]
+                       : width_ == 2 ? reinterpret_cast<const uint16_t*>(buf_.data())[i]
+                       : reinterpret_cast<const uint32_t*>(buf_.data())[i];
+            out[i] = (v == none()) ? -1 : static_cast<int>(v);
+        }
+    }
+
+    void write(long long first, int n, const int* in) {
+        buf_.resize((size_t)n * width_);
+        for (int i = 0; i < n; i++) {
+            uint32_t v = in[i] < 0 ? none() : static_cast<uint32_t>(in[i]);
+            if (width_ == 1) buf_[i] = static_cast<uint8_t>(v);
+            else if (width_ == 2) reinterpret_cast<uint16_t*>(buf_.data())[i] = static_cast<uint16_t>(v);
+            else reinterpret_cast<uint32_t*>(buf_.data())[i] = v;
+        }
+        if (pwrite(fd_, buf_.data(), buf_.size(), first * width_) != (ssize_t)buf_.size()) {
+            std::cerr << "Erro ao gravar rótulos em " << path_ << std::endl;
+            exit(1);
+        }
+    }
+
+private:
+    uint32_t none() const { return width_ == 1 ? 0xFF : width_ == 2 ? 0xFFFF : 0xFFFFFFFFu; }
+
+    std::string path_;
+    int fd_ = -1;
+    int width_ = 1;
+    std::vector<uint8_t> buf_;
+};
+
+// -----------------------------------------------------------------------------
+// ChunkPrefetcher: thread de E/S que enche um de dois buffers com o próximo
+// pedaço do RowSource enquanto o outro é processado.
+// -----------------------------------------------------------------------------
+class ChunkPrefetcher {
+public:
+    ChunkPrefetcher(RowSource& src, int chunk_rows)
+        : src_(src), chunk_(chunk_rows) {
+        for (int b = 0; b < 2; b++) buf_[b].reset(chunk_rows, src.dim());
+        io_ = std::thread([this] { loop(); });
+    }
+    ChunkPrefetcher(const ChunkPrefetcher&) = delete;
+    ChunkPrefetcher& operator=(const ChunkPrefetcher&) = delete;
+    ~ChunkPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        io_.join();
+    }
+
+    // Volta ao início do arquivo e já pede o primeiro pedaço no buffer 0
+    void start_pass() {
+        wait_idle();
+        src_.rewind();
+        request(0);
+    }
+
+    // Pede o próximo pedaço no buffer b (que não pode estar em uso)
+    void request(int b) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            ready_[b] = false;
+            pending_ = b;
+        }
+        cv_.notify_all();
+    }
+
+    // Espera o buffer b ficar pronto; devolve quantas linhas ele tem (0 = fim)
+    int wait(int b) {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [&] { return ready_[b]; });
+        return rows_[b];
+    }
+
+    Matrix<double>& buffer(int b) { return buf_[b]; }
+
+private:
+    void wait_idle() {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [&] { return pending_ < 0 && !busy_; });
+    }
+
+    void loop() {
+        unbind_this_thread();   // não disputa a CPU da thread 0 do OpenMP
+        std::unique_lock<std::mutex> lk(m_);
+        for (;;) {
+            cv_.wait(lk, [&] { return stop_ || pending_ >= 0; });
+            if (stop_) return;
+            const int b = pending_;
+            pending_ = -1;
+            busy_ = true;
+            lk.unlock();
+            const int n = src_.read_block(chunk_, buf_[b]);
+            lk.lock();
+            busy_ = false;
+            rows_[b] = n;
+            ready_[b] = true;
+            cv_.notify_all();
+        }
+    }
+
+    RowSource& src_;
+    const int chunk_;
+    Matrix<double> buf_[2];
+    int rows_[2] = {0, 0};
+    bool ready_[2] = {false, false};
+    int pending_ = -1;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::thread io_;
+};
+
+struct OutOfCoreResult {
+    Matrix<double> centroids;              // K×D finais
+    int iterations = 0;                    // mesmo significado de KMeansResult
+    bool converged = false;
+    std::vector<long long> cluster_size;   // da última atribuição
+    std::vector<double> iter_secs;         // tempo de cada iteração
+    std::vector<double> io_wait_secs;      // parte dele esperando E/S
+};
+
+// -----------------------------------------------------------------------------
+// kmeans_out_of_core: mesmo laço de kmeans_lloyd sobre N linhas lidas do
+// disco. chunk_rows é arredondado para múltiplo de REDUCE_BLOCK; com use_gemm
+// a atribuição de cada pedaço usa o GemmAssigner, como em memória.
+// -----------------------------------------------------------------------------
+inline OutOfCoreResult kmeans_out_of_core(RowSource& src, long long N, Matrix<double> C, int max_iter,
+                                          const DistanceKernel& kern, int chunk_rows, LabelFile& lf,
+                                          bool use_gemm) {
+    using clock = std::chrono::steady_clock;
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    chunk_rows = std::max(1, (chunk_rows + REDUCE_BLOCK - 1) / REDUCE_BLOCK) * REDUCE_BLOCK;
+
+    OutOfCoreResult res;
+    ChunkPrefetcher pf(src, chunk_rows);
+    CentroidSums acc(K, D);
+    std::vector<int> labels(chunk_rows);
+
+    for (int iter = 0; iter < max_iter; iter++) {
+        const auto t0 = clock::now();
+        double io = 0.0;
+        auto timed = [&](auto&& f) {
+            const auto a = clock::now();
+            auto r = f();
+            io += std::chrono::duration<double>(clock::now() - a).count();
+            return r;
+        };
+        res.iterations = iter + 1;
+        acc.clear();
+        long long changed = 0;
+        long long first = 0;
+        int cur = 0;
+        pf.start_pass();
+        for (;;) {
+            const int n = timed([&] { return pf.wait(cur); });
+            if (n == 0) break;
+            pf.request(cur ^ 1);   // lê o próximo enquanto este é processado
+            const Matrix<double>& X = pf.buffer(cur);
+            if (iter == 0) std::fill(labels.begin(), labels.begin() + n, -1);
+            else timed([&] { lf.read(first, n, labels.data()); return 0; });
+
+            // Atribuição e acumulação (igual a kmeans_lloyd): seguem a mesma
+            // sequência de blocos, então os bits batem com o caminho em memória
+            if (use_gemm) {
+                GemmAssigner gemm(X, n, D);
+                changed += gemm.assign(C, K, labels);
+                acc.add(X, n, labels.data());
+            } else {
+                changed += acc.assign_add(X, n, C, kern, labels.data());
+            }
+            timed([&] { lf.write(first, n, labels.data()); return 0; });
+            first += n;
+            cur ^= 1;
+        }
+        if (first != N) {
+            std::cerr << "Aviso: a passada leu " << first << " linhas, esperado " << N << std::endl;
+        }
+        res.cluster_size = acc.count();
+        if (changed) acc.apply(C);
+        res.iter_secs.push_back(std::chrono::duration<double>(clock::now() - t0).count());
+        res.io_wait_secs.push_back(io);
+        if (!changed) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+    }
+    res.centroids = std::move(C);
+    return res;
+}
@@ -0,0 +1,254 @@
+// packed.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Colunas binárias empacotadas em bits (--pack-binary).
+//
+// pack_binary() acha as colunas que só têm 0 e 1 (no covtype, as 44 colunas
+// one-hot de área e tipo de solo) e reescreve cada linha como [Dc doubles das
+// colunas contínuas][W palavras de 64 bits], sem padding entre linhas: com
+// D = 54 e Dc = 10 são 88 bytes por linha em vez de 448.
+//
+// Distância híbrida ao centróide c (parte densa cd, parte binária cb, que é
+// uma média e portanto real em [0, 1]):
+//   ||x - c||² = ||xd - cd||² + Σ_j (xb_j - cb_j)²
+//              = ||xd - cd||² + ||cb||² + Σ_{j: xb_j = 1} (1 - 2·cb_j)
+// A parte densa usa o kernel SIMD para Dc; ||cb||² e 1 - 2·cb_j são
+// calculados uma vez por centróide e iteração, e a parte binária custa uma
+// soma por bit ligado (2 por linha no covtype). É a mesma distância, só somada
+// em outra ordem; os rótulos só podem diferir num empate exato de arredondamento.
+//
+// As somas da atualização seguem a ordem de blocos de CentroidSums, e a parte
+// binária soma contagens inteiras: com os mesmos rótulos, os centróides saem
+// idênticos aos do Lloyd sobre os dados densos.
+// -----------------------------------------------------------------------------
+
+struct PackedData {
+    int N = 0, D = 0;           // dimensões originais
+    int Dc = 0;                 // colunas contínuas (densas)
+    int B = 0;                  // colunas binárias
+    int W = 0;                  // palavras de 64 bits por linha
+    int S = 0;                  // passo da linha em palavras de 8 bytes (Dc + W)
+    std::vector<int> dense_cols, bin_cols;   // coluna original de cada parte
+    Matrix<double> buf;         // 1×(N·S): linhas empacotadas, contíguas
+
+    const double* dense(int i) const { return buf.data() + static_cast<size_t>(i) * S; }
+    uint64_t word(int i, int w) const {
+        uint64_t v;
+        std::memcpy(&v, dense(i) + Dc + w, sizeof(v));
+        return v;
+    }
+    size_t row_bytes() const { return static_cast<size_t>(S) * sizeof(double); }
+};
+
+// -----------------------------------------------------------------------------
+// pack_binary: detecta as colunas 0/1 de X e monta a representação empacotada
+// -----------------------------------------------------------------------------
+inline PackedData pack_binary(const Matrix<double>& X, int N) {
+    const int D = static_cast<int>(X.cols());
+    PackedData P;
+    P.N = N;
+    P.D = D;
+
+    // Coluna binária: todos os valores são 0 ou 1 (cada thread olha um trecho)
+    std::vector<char> binary(D, 1);
+    #pragma omp parallel
+    {
+        std::vector<char> mine(D, 1);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < N; i++) {
+            const double* x = X.row(i);
+            for (int d = 0; d < D; d++) mine[d] &= (x[d] == 0.0 || x[d] == 1.0);
+        }
+        #pragma omp critical
+        for (int d = 0; d < D; d++) binary[d] &= mine[d];
+    }
+    for (int d = 0; d < D; d++) (binary[d] ? P.bin_cols : P.dense_cols).push_back(d);
+    P.Dc = static_cast<int>(P.dense_cols.size());
+    P.B = static_cast<int>(P.bin_cols.size());
+    P.W = (P.B + 63) / 64;
+    P.S = P.Dc + P.W;
+
+    P.buf.reset(1, static_cast<size_t>(N) * std::max(P.S, 1), false);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < N; i++) {
+        const double* x = X.row(i);
+        double* out = P.buf.data() + static_cast<size_t>(i) * P.S;
+        for (int d = 0; d < P.Dc; d++) out[d] = x[P.dense_cols[d]];
+        for (int w = 0; w < P.W; w++) {
+            uint64_t v = 0;
+            for (int j = w * 64; j < std::min(P.B, (w + 1) * 64); j++)
+                if (x[P.bin_cols[j]] != 0.0) v |= uint64_t(1) << (j - w * 64);
+            std::memcpy(out + P.Dc + w, &v, sizeof(v));
+        }
+    }
+    return P;
+}
+
+// -----------------------------------------------------------------------------
+// PackedSums: atribuição híbrida + somas por centróide na ordem fixa de
+// blocos (mesmo esquema de levas e áreas parciais de CentroidSums)
+// -----------------------------------------------------------------------------
+class PackedSums {
+public:
+    PackedSums(const PackedData& P, int K)
+        : P_(P), K_(K), E_(P.Dc + P.B), sum_(K, E_), count_(K, 0), cd_(K, std::max(P.Dc, 1)),
+          wb_(K, std::max(P.B, 1)), nb_(K, 0.0), kern_(select_kernel(std::max(P.Dc, 1))) {
+        slots_ = 1;
+#ifdef _OPENMP
+        slots_ = omp_get_max_threads();
+#endif
+        part_.resize(slots_);
+        #pragma omp parallel for schedule(static, 1)
+        for (int w = 0; w < slots_; w++) {
+            part_[w].sum.reset(K, E_);
+            part_[w].count.reset(1, K);
+            part_[w].bits.resize(P.B);
+        }
+    }
+
+    const std::string& dense_kernel() const { return kern_.name; }
+
+    // Atribui cada linha ao centróide mais próximo de C (K×D, colunas
+    // originais) e soma; devolve quantos rótulos mudaram
+    long long assign_add(const Matrix<double>& C, int* labels) {
+        prepare(C);
+        sum_.zero();
+        std::fill(count_.begin(), count_.end(), 0);
+        const PackedData& P = P_;
+        const int K = K_, Dc = P.Dc, E = E_;
+        const int nb = (P.N + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+        const auto sqdist = kern_.sqdist;
+        long long changed = 0;
+        for (int b0 = 0; b0 < nb; b0 += slots_) {
+            const int wn = std::min(slots_, nb - b0);
+            #pragma omp parallel for schedule(static, 1) reduction(+:changed)
+            for (int w = 0; w < wn; w++) {
+                Matrix<double>& ps = part_[w].sum;
+                long long* pc = part_[w].count.data();
+                int* set = part_[w].bits.data();
+                ps.zero();
+                std::fill(pc, pc + K, 0);
+                const int i0 = (b0 + w) * REDUCE_BLOCK;
+                const int i1 = std::min(P.N, i0 + REDUCE_BLOCK);
+                for (int i = i0; i < i1; i++) {
+                    const double* x = P.dense(i);
+                    // Índices dos bits ligados (uma vez por linha, usados para os K centróides)
+                    int ns = 0;
+                    for (int q = 0; q < P.W; q++) {
+                        for (uint64_t v = P.word(i, q); v; v &= v - 1)
+                            set[ns++] = q * 64 + __builtin_ctzll(v);
+                    }
+                    double best = std::numeric_limits<double>::infinity();
+                    int c = 0;
+                    for (int k = 0; k < K; k++) {
+                        double d = Dc ? sqdist(x, cd_.row(k), Dc) : 0.0;
+                        const double* wk = wb_.row(k);
+                        double t = nb_[k];
+                        for (int s = 0; s < ns; s++) t += wk[set[s]];
+                        d += t;
+                        if (d < best) { best = d; c = k; }
+                    }
+                    if (labels[i] != c) {
+                        labels[i] = c;
+                        changed++;
+                    }
+                    double* s = ps.row(c);
+                    pc[c]++;
+                    for (int d = 0; d < Dc; d++) s[d] += x[d];
+                    for (int q = 0; q < ns; q++) s[Dc + set[q]] += 1.0;
+                }
+            }
+            merge(wn, E);
+        }
+        return changed;
+    }
+
+    // Cada centróide (colunas originais) vira a média dos seus pontos
+    void apply(Matrix<double>& C) const {
+        const PackedData& P = P_;
+        for (int k = 0; k < K_; k++) {
+            if (count_[k] == 0) continue; // evita divisão por zero
+            for (int d = 0; d < P.Dc; d++) C(k, P.dense_cols[d]) = sum_(k, d) / count_[k];
+            for (int j = 0; j < P.B; j++) C(k, P.bin_cols[j]) = sum_(k, P.Dc + j) / count_[k];
+        }
+    }
+
+private:
+    // Parte densa de C, 1 - 2·cb_j e ||cb||² de cada centróide
+    void prepare(const Matrix<double>& C) {
+        const PackedData& P = P_;
+        for (int k = 0; k < K_; k++) {
+            for (int d = 0; d < P.Dc; d++) cd_(k, d) = C(k, P.dense_cols[d]);
+            double n2 = 0.0;
+            for (int j = 0; j < P.B; j++) {
+                const double cb = C(k, P.bin_cols[j]);
+                wb_(k, j) = 1.0 - 2.0 * cb;
+                n2 += cb * cb;
+            }
+            nb_[k] = n2;
+        }
+    }
+
+    void merge(int wn, int E) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < K_; k++) {
+            double* s = sum_.row(k);
+            for (int w = 0; w < wn; w++) {
+                const double* ps = part_[w].sum.row(k);
+                for (int e = 0; e < E; e++) s[e] += ps[e];
+            }
+        }
+        for (int w = 0; w < wn; w++) {
+            const long long* pc = part_[w].count.data();
+            for (int k = 0; k < K_; k++) count_[k] += pc[k];
+        }
+    }
+
+    struct Partial {
+        Matrix<double> sum;         // K×(Dc+B), ordem empacotada
+        Matrix<long long> count;    // 1×K
+        std::vector<int> bits;      // bits ligados da linha atual
+    };
+
+    const PackedData& P_;
+    int K_, E_, slots_;
+    Matrix<double> sum_;
+    std::vector<long long> count_;
+    Matrix<double> cd_, wb_;        // parte densa e pesos 1 - 2·cb dos centróides
+    std::vector<double> nb_;        // ||cb||²
+    DistanceKernel kern_;           // kernel SIMD para as Dc colunas densas
+    std::vector<Partial> part_;
+};
+
+// -----------------------------------------------------------------------------
+// kmeans_lloyd_packed: Lloyd sobre os dados empacotados; C e o resultado
+// usam as colunas originais
+// -----------------------------------------------------------------------------
+inline KMeansResult kmeans_lloyd_packed(const PackedData& P, Matrix<double> C, int max_iter) {
+    const int K = static_cast<int>(C.rows());
+    KMeansResult res;
+    res.labels.assign(P.N, -1);
+    PackedSums acc(P, K);
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        IterationScope it_scope(iter);
+        const long long changed = acc.assign_add(C, res.labels.data());
+        it_scope.set(std::numeric_limits<double>::quiet_NaN(), changed);
+        if (changed == 0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+        acc.apply(C);
+    }
+    res.centroids = std::move(C);
+    return res;
+}
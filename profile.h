@@ -0,0 +1,224 @@
+// profile.h
+#pragma once
+#include <bits/stdc++.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Instrumentação por fase (--profile=arquivo.json|arquivo.csv [--perf]).
+//
+// ProfileScope marca uma fase ("load", "init", "assign", "update", ...) ou
+// uma iteração inteira; ao sair do escopo grava o tempo e, com --perf, os
+// contadores de hardware (ciclos, instruções, falhas de LLC) somados em todas
+// as threads do time OpenMP. Cada thread abre o seu grupo de contadores via
+// perf_event_open (só espaço de usuário), então não é preciso libpfm nem
+// permissão de root quando perf_event_paranoid <= 2.
+//
+// Desligado, cada escopo custa um teste de bool: os laços internos não têm
+// instrumentação, só as fronteiras de fase e de iteração. O arquivo (JSON ou
+// CSV, pela extensão) é gravado no fim do programa (destrutor do Profiler).
+// -----------------------------------------------------------------------------
+
+struct PerfCounts {
+    long long cycles = 0, instructions = 0, llc_misses = 0;
+};
+
+// Um registro do trace: fase (iter = iteração a que pertence, -1 se nenhuma)
+// ou iteração (kind = "iteration", com inércia e pontos que mudaram)
+struct ProfileEvent {
+    std::string kind, name;
+    int iter = -1;
+    double start = 0.0, secs = 0.0;   // segundos desde Profiler::enable
+    double inertia = std::numeric_limits<double>::quiet_NaN();
+    long long moved = -1;
+    PerfCounts pc;
+};
+
+class Profiler {
+public:
+    bool enabled = false;
+    bool counters = false;
+
+    // Liga o trace; com want_counters abre um grupo de contadores por thread
+    void enable(const std::string& path, bool want_counters) {
+        path_ = path;
+        enabled = true;
+        t0_ = std::chrono::steady_clock::now();
+        if (!want_counters) return;
+        int T = 1;
+#ifdef _OPENMP
+        T = omp_get_max_threads();
+#endif
+        fds_.assign(T, {-1, -1, -1});
+        bool ok = true;
+        #pragma omp parallel num_threads(T) reduction(&&:ok)
+        {
+            int t = 0;
+#ifdef _OPENMP
+            t = omp_get_thread_num();
+#endif
+            ok = open_group(fds_[t]);
+        }
+        counters = ok;
+        if (!ok) {
+            std::cerr << "Aviso: perf_event_open indisponível (perf_event_paranoid?), "
+                      << "trace sem contadores" << std::endl;
+            close_all();
+        }
+    }
+
+    double now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();
+    }
+
+    // Soma dos contadores de todas as threads
+    PerfCounts read() const {
+        PerfCounts pc;
+        if (!counters) return pc;
+        for (const auto& g : fds_) {
+            struct { uint64_t nr; uint64_t v[3]; } buf{};
+            if (::read(g[0], &buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t) || buf.nr != 3) continue;
+            pc.cycles += buf.v[0];
+            pc.instructions += buf.v[1];
+            pc.llc_misses += buf.v[2];
+        }
+        return pc;
+    }
+
+    void record(ProfileEvent e) { events_.push_back(std::move(e)); }
+
+    // Grava o trace (JSON ou CSV conforme a extensão de path)
+    bool write() const {
+        if (!enabled) return true;
+        std::ofstream out(path_);
+        if (!out) {
+            std::cerr << "Erro ao criar trace: " << path_ << std::endl;
+            return false;
+        }
+        const bool csv = path_.size() >= 4 && path_.compare(path_.size() - 4, 4, ".csv") == 0;
+        out << std::setprecision(9);
+        if (csv) {
+            out << "kind,name,iter,start,secs,inertia,moved,cycles,instructions,llc_misses\n";
+            for (const ProfileEvent& e : events_) {
+                out << e.kind << "," << e.name << "," << e.iter << "," << e.start << "," << e.secs << ",";
+                if (!std::isnan(e.inertia)) out << e.inertia;
+                out << ",";
+                if (e.moved >= 0) out << e.moved;
+                out << ",";
+                if (counters) out << e.pc.cycles << "," << e.pc.instructions << "," << e.pc.llc_misses;
+                else out << ",,";
+                out << "\n";
+            }
+        } else {
+            out << "{\"counters\": " << (counters ? "true" : "false") << ", \"events\": [\n";
+            for (size_t i = 0; i < events_.size(); i++) {
+                const ProfileEvent& e = events_[i];
+                out << "  {\"kind\": \"" << e.kind << "\", \"name\": \"" << e.name << "\", \"iter\": " << e.iter
+                    << ", \"start\": " << e.start << ", \"secs\": " << e.secs;
+                if (!std::isnan(e.inertia)) out << ", \"inertia\": " << e.inertia;
+                if (e.moved >= 0) out << ", \"moved\": " << e.moved;
+                if (counters)
+                    out << ", \"cycles\": " << e.pc.cycles << ", \"instructions\": " << e.pc.instructions
+                        << ", \"llc_misses\": " << e.pc.llc_misses;
+                out << "}" << (i + 1 < events_.size() ? "," : "") << "\n";
+            }
+            out << "]}\n";
+        }
+        return true;
+    }
+
+    ~Profiler() {
+        if (enabled && write()) std::cout << "→ Trace em " << path_ << std::endl;
+        close_all();
+    }
+
+private:
+    static int perf_open(uint32_t type, uint64_t config, int group) {
+        perf_event_attr a{};
+        a.size = sizeof(a);
+        a.type = type;
+        a.config = config;
+        a.disabled = group < 0;
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        a.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(syscall(SYS_perf_event_open, &a, 0, -1, group, 0));
+    }
+
+    // Líder = ciclos; instruções e falhas de LLC no mesmo grupo (lidos juntos)
+    static bool open_group(std::array<int, 3>& g) {
+        g[0] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (g[0] < 0) return false;
+        g[1] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, g[0]);
+        g[2] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, g[0]);
+        if (g[1] < 0 || g[2] < 0) return false;
+        ioctl(g[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    void close_all() {
+        for (auto& g : fds_)
+            for (int& fd : g)
+                if (fd >= 0) { close(fd); fd = -1; }
+        fds_.clear();
+    }
+
+    std::string path_;
+    std::chrono::steady_clock::time_point t0_;
+    std::vector<std::array<int, 3>> fds_;   // contadores de cada thread
+    std::vector<ProfileEvent> events_;
+};
+
+inline Profiler& profiler() {
+    static Profiler p;
+    return p;
+}
+
+// -----------------------------------------------------------------------------
+// ProfileScope: registra o trecho entre construção e destruição. Em uma
+// iteração, set() anexa a inércia e quantos pontos mudaram de cluster.
+// -----------------------------------------------------------------------------
+class ProfileScope {
+public:
+    ProfileScope(const char* name, int iter = -1, const char* kind = "phase")
+        : on_(profiler().enabled) {
+        if (!on_) return;
+        e_.kind = kind;
+        e_.name = name;
+        e_.iter = iter;
+        e_.pc = profiler().read();
+        e_.start = profiler().now();
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ~ProfileScope() {
+        if (!on_) return;
+        Profiler& p = profiler();
+        e_.secs = p.now() - e_.start;
+        const PerfCounts end = p.read();
+        e_.pc.cycles = end.cycles - e_.pc.cycles;
+        e_.pc.instructions = end.instructions - e_.pc.instructions;
+        e_.pc.llc_misses = end.llc_misses - e_.pc.llc_misses;
+        p.record(std::move(e_));
+    }
+
+    void set(double inertia, long long moved) {
+        if (!on_) return;
+        e_.inertia = inertia;
+        e_.moved = moved;
+    }
+
+private:
+    bool on_;
+    ProfileEvent e_;
+};
+
+// Escopo de uma iteração inteira (kind = "iteration")
+struct IterationScope : ProfileScope {
+    explicit IterationScope(int iter) : ProfileScope("iteration", iter, "iteration") {}
+};
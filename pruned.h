@@ -0,0 +1,423 @@
+// pruned.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// K-Means com poda por desigualdade triangular (Hamerly e Elkan).
+//
+// Cada ponto guarda um limite superior u (distância ao próprio centróide) e
+// limites inferiores l (distância aos demais). Depois da atualização, cada
+// centróide se desloca drift[k]: u cresce drift[a] e l diminui drift[j], e
+// os limites continuam válidos sem recalcular nada. Enquanto u < l o rótulo
+// não pode mudar, então as distâncias desse ponto não são calculadas. Com
+// s[k] = metade da distância de k ao centróide mais próximo, u < s[a] também
+// garante que o rótulo fica.
+//
+// Os rótulos são os mesmos do Lloyd (empate: menor índice). As poucas
+// distâncias calculadas usam o mesmo kernel SIMD (kern.sqdist) com sqrt.
+// Com delta = true a atualização usa RunningSums: com quase todos os pontos
+// podados, a atualização completa O(N·D) passa a dominar a iteração e os
+// deltas a trocam por O(movidos·D).
+//
+//  - Hamerly: um único limite inferior por ponto (o segundo mais próximo);
+//    memória O(N), bom para K pequeno/médio e D baixo.
+//  - Elkan: um limite inferior por ponto e centróide (N×K) e as distâncias
+//    entre todos os centróides; poda mais, ao custo de O(N·K) de memória.
+//  - Yinyang: os centróides são agrupados (K-Means sobre os próprios
+//    centróides) e cada ponto guarda um limite por grupo, O(N·G) com G ≈ K/10;
+//    serve para K na casa das centenas.
+// -----------------------------------------------------------------------------
+
+#define PRUNED_CHUNK 1024       // pontos por bloco no schedule dinâmico (custo varia com a poda)
+#define YINYANG_GROUP_SIZE 10   // centróides por grupo (em média) no Yinyang
+#define YINYANG_GROUP_ITERS 5   // iterações do K-Means que agrupa os centróides
+
+namespace pruned_detail {
+
+inline double dist(const DistanceKernel& kern, const double* a, const double* b, int D) {
+    return std::sqrt(kern.sqdist(a, b, D));
+}
+
+// cc(j, j') = distância entre centróides; s[j] = metade da menor delas
+inline void centroid_distances(const DistanceKernel& kern, const Matrix<double>& C,
+                               Matrix<double>* cc, std::vector<double>& s) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int j = 0; j < K; j++) {
+        double m = std::numeric_limits<double>::infinity();
+        for (int k = 0; k < K; k++) {
+            if (k == j) continue;
+            double d = dist(kern, C.row(j), C.row(k), D);
+            if (cc) (*cc)(j, k) = d;
+            m = std::min(m, d);
+        }
+        s[j] = 0.5 * m;
+    }
+}
+
+// Deslocamento de cada centróide na última atualização
+inline void centroid_drift(const DistanceKernel& kern, const Matrix<double>& old_c,
+                           const Matrix<double>& C, std::vector<double>& drift) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    for (int k = 0; k < K; k++) drift[k] = dist(kern, old_c.row(k), C.row(k), D);
+}
+
+}  // namespace pruned_detail
+
+// -----------------------------------------------------------------------------
+// kmeans_hamerly: mesma interface e resultado de kmeans_lloyd.
+// -----------------------------------------------------------------------------
+inline KMeansResult kmeans_hamerly(const Matrix<double>& X, int N, Matrix<double> C, int max_iter,
+                                   const DistanceKernel& kern, bool delta = false) {
+    using namespace pruned_detail;
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    KMeansResult res;
+    res.labels.assign(N, -1);
+    std::vector<int>& labels = res.labels;
+    std::vector<double> upper(N), lower(N);
+    std::vector<double> s(K), drift(K);
+    Matrix<double> old_c(K, D);
+    RunningSums upd(K, D, delta);
+
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        IterationScope it_scope(iter);   // --profile: tempo e pontos que mudaram
+        res.dist_full += (long long)N * K;
+        if (iter > 0) {
+            centroid_distances(kern, C, nullptr, s);
+            res.dist_centroid += (long long)K * (K - 1);
+        }
+        long long changed = 0, computed = 0;
+
+        #pragma omp parallel for schedule(dynamic, PRUNED_CHUNK) reduction(+:changed, computed)
+        for (int i = 0; i < N; i++) {
+            const double* x = X.row(i);
+            int a = labels[i];
+            if (a >= 0) {
+                const double m = std::max(s[a], lower[i]);
+                if (upper[i] < m) continue;
+                // Aperta o limite superior e testa de novo
+                upper[i] = dist(kern, x, C.row(a), D);
+                computed++;
+                if (upper[i] < m) continue;
+            }
+            // Busca completa: mais próximo e segundo mais próximo
+            double d1 = std::numeric_limits<double>::infinity(), d2 = d1;
+            int best = 0;
+            for (int k = 0; k < K; k++) {
+                double d = (k == a) ? upper[i] : dist(kern, x, C.row(k), D);
+                if (d < d1) { d2 = d1; d1 = d; best = k; }
+                else if (d < d2) d2 = d;
+            }
+            computed += (a >= 0) ? K - 1 : K;
+            upper[i] = d1;
+            lower[i] = d2;
+            if (best != a) { upd.move(i, a, best); labels[i] = best; changed++; }
+        }
+        res.dist_computed += computed;
+
+        it_scope.set(std::numeric_limits<double>::quiet_NaN(), changed);
+        if (changed == 0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+
+        std::copy_n(C.data(), C.size(), old_c.data());
+        if (const long long applied = upd.update(X, N, labels, C); applied >= 0) {
+            res.delta_updates++;
+            res.moved += applied;
+        }
+        centroid_drift(kern, old_c, C, drift);
+
+        // Maior e segundo maior deslocamento: o limite inferior de um ponto
+        // cai pelo maior deslocamento entre os centróides que não são o dele
+        int kmax = 0;
+        for (int k = 1; k < K; k++) if (drift[k] > drift[kmax]) kmax = k;
+        double second = 0.0;
+        for (int k = 0; k < K; k++) if (k != kmax) second = std::max(second, drift[k]);
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < N; i++) {
+            const int a = labels[i];
+            upper[i] += drift[a];
+            lower[i] -= (a == kmax) ? second : drift[kmax];
+        }
+    }
+    res.centroids = std::move(C);
+    return res;
+}
+
+// -----------------------------------------------------------------------------
+// kmeans_elkan: mesma interface e resultado de kmeans_lloyd.
+// -----------------------------------------------------------------------------
+inline KMeansResult kmeans_elkan(const Matrix<double>& X, int N, Matrix<double> C, int max_iter,
+                                 const DistanceKernel& kern, bool delta = false) {
+    using namespace pruned_detail;
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    KMeansResult res;
+    res.labels.assign(N, -1);
+    std::vector<int>& labels = res.labels;
+    std::vector<double> upper(N);
+    Matrix<double> lower(N, K);   // l(i, k): limite inferior de d(x_i, c_k)
+    Matrix<double> cc(K, K);      // distâncias entre centróides
+    std::vector<double> s(K), drift(K);
+    Matrix<double> old_c(K, D);
+    RunningSums upd(K, D, delta);
+
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        IterationScope it_scope(iter);
+        res.dist_full += (long long)N * K;
+        if (iter > 0) {
+            centroid_distances(kern, C, &cc, s);
+            res.dist_centroid += (long long)K * (K - 1);
+        }
+        long long changed = 0, computed = 0;
+
+        #pragma omp parallel for schedule(dynamic, PRUNED_CHUNK) reduction(+:changed, computed)
+        for (int i = 0; i < N; i++) {
+            const double* x = X.row(i);
+            double* l = lower.row(i);
+            int a = labels[i];
+
+            if (a < 0) {
+                // Primeira iteração: todas as distâncias, limites exatos
+                double best_d = std::numeric_limits<double>::infinity();
+                int best = 0;
+                for (int k = 0; k < K; k++) {
+                    l[k] = dist(kern, x, C.row(k), D);
+                    if (l[k] < best_d) { best_d = l[k]; best = k; }
+                }
+                computed += K;
+                upper[i] = best_d;
+                labels[i] = best;
+                changed++;
+                continue;
+            }
+
+            double u = upper[i];
+            if (u < s[a]) continue;
+            bool tight = false;   // u já é a distância exata ao centróide atual?
+            const int a0 = a;
+            for (int k = 0; k < K; k++) {
+                if (k == a) continue;
+                if (u < l[k] || u < 0.5 * cc(a, k)) continue;
+                if (!tight) {
+                    u = dist(kern, x, C.row(a), D);
+                    l[a] = u;
+                    tight = true;
+                    computed++;
+                    if (u < l[k] || u < 0.5 * cc(a, k)) continue;
+                }
+                double d = dist(kern, x, C.row(k), D);
+                l[k] = d;
+                computed++;
+                if (d < u || (d == u && k < a)) { a = k; u = d; }
+            }
+            upper[i] = u;
+            if (a != a0) { upd.move(i, a0, a); labels[i] = a; changed++; }
+        }
+        res.dist_computed += computed;
+
+        it_scope.set(std::numeric_limits<double>::quiet_NaN(), changed);
+        if (changed == 0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+
+        std::copy_n(C.data(), C.size(), old_c.data());
+        if (const long long applied = upd.update(X, N, labels, C); applied >= 0) {
+            res.delta_updates++;
+            res.moved += applied;
+        }
+        centroid_drift(kern, old_c, C, drift);
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < N; i++) {
+            double* l = lower.row(i);
+            for (int k = 0; k < K; k++) l[k] = std::max(0.0, l[k] - drift[k]);
+            upper[i] += drift[labels[i]];
+        }
+    }
+    res.centroids = std::move(C);
+    return res;
+}
+
+// -----------------------------------------------------------------------------
+// Yinyang K-Means (Ding et al., 2015): um limite inferior por grupo de
+// centróides. Após a atualização, o limite do grupo g cai pelo maior
+// deslocamento entre seus membros.
+//   - filtro global: u < min_g lb[g]  → nenhum centróide pode ganhar;
+//   - filtro de grupo: u < lb[g]      → ninguém do grupo g pode ganhar;
+//   - filtro local: dentro de um grupo que passou, pula o centróide j se
+//     lb[g] antes da queda − drift[j] já passa de u.
+// -----------------------------------------------------------------------------
+namespace pruned_detail {
+
+// Agrupa os K centróides em até G grupos (sementes espaçadas, poucas
+// iterações de Lloyd); grupos vazios são descartados.
+inline std::vector<std::vector<int>> group_centroids(const DistanceKernel& kern, const Matrix<double>& C, int G) {
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    Matrix<double> gc(G, D);
+    CentroidSums acc(G, D);
+    std::vector<int> of(K, 0);
+    for (int g = 0; g < G; g++) std::copy_n(C.row((size_t)g * K / G), D, gc.row(g));
+    for (int it = 0; it < YINYANG_GROUP_ITERS; it++) {
+        for (int k = 0; k < K; k++) of[k] = kern.nearest(C.row(k), gc.data(), gc.stride(), G, D, nullptr);
+        update_centroids(C, K, of, gc, acc);
+    }
+    std::vector<std::vector<int>> groups(G);
+    for (int k = 0; k < K; k++) groups[of[k]].push_back(k);
+    groups.erase(std::remove_if(groups.begin(), groups.end(),
+                                [](const std::vector<int>& g) { return g.empty(); }),
+                 groups.end());
+    return groups;
+}
+
+}  // namespace pruned_detail
+
+inline KMeansResult kmeans_yinyang(const Matrix<double>& X, int N, Matrix<double> C, int max_iter,
+                                   const DistanceKernel& kern, bool delta = false) {
+    using namespace pruned_detail;
+    const int K = static_cast<int>(C.rows());
+    const int D = static_cast<int>(C.cols());
+    const std::vector<std::vector<int>> groups =
+        group_centroids(kern, C, std::max(1, K / YINYANG_GROUP_SIZE));
+    const int G = static_cast<int>(groups.size());
+    std::vector<int> group_of(K);
+    for (int g = 0; g < G; g++)
+        for (int k : groups[g]) group_of[k] = g;
+
+    KMeansResult res;
+    res.labels.assign(N, -1);
+    std::vector<int>& labels = res.labels;
+    std::vector<double> upper(N);
+    Matrix<double> lower(N, G);   // lb(i, g): limite inferior da distância a qualquer
+                                  // centróide do grupo g que não seja o do ponto
+    std::vector<double> drift(K, 0.0), gdrift(G, 0.0);
+    Matrix<double> old_c(K, D);
+    RunningSums upd(K, D, delta);
+    const double inf = std::numeric_limits<double>::infinity();
+
+    for (int iter = 0; iter < max_iter; iter++) {
+        res.iterations = iter + 1;
+        IterationScope it_scope(iter);
+        res.dist_full += (long long)N * K;
+        long long changed = 0, computed = 0;
+
+        #pragma omp parallel reduction(+:changed, computed)
+        {
+            // Menor e segundo menor valor por grupo (distância ou limite) e
+            // o centróide do menor (-1 se o menor for só um limite)
+            std::vector<double> m1(G), m2(G);
+            std::vector<int> i1(G);
+            std::vector<char> seen(G);
+
+            #pragma omp for schedule(dynamic, PRUNED_CHUNK)
+            for (int i = 0; i < N; i++) {
+                const double* x = X.row(i);
+                double* lb = lower.row(i);
+                int a = labels[i];
+                double u;
+                int a0 = a;
+                double d0 = 0.0;
+
+                if (a >= 0) {
+                    double glb = inf;
+                    for (int g = 0; g < G; g++) glb = std::min(glb, lb[g]);
+                    // Filtro global
+                    if (upper[i] < glb) continue;
+                    u = d0 = dist(kern, x, C.row(a), D);
+                    computed++;
+                    upper[i] = u;
+                    if (u < glb) continue;
+                } else {
+                    u = inf;
+                }
+
+                std::fill(seen.begin(), seen.end(), 0);
+                for (int g = 0; g < G; g++) {
+                    // Filtro de grupo
+                    if (a0 >= 0 && u < lb[g]) continue;
+                    seen[g] = 1;
+                    m1[g] = m2[g] = inf;
+                    i1[g] = -1;
+                    const double before = lb[g] + gdrift[g];   // limite antes da queda
+                    for (int k : groups[g]) {
+                        double d;
+                        int who = k;
+                        if (k == a0) {
+                            d = d0;
+                        } else if (a0 >= 0 && u < before - drift[k]) {
+                            // Filtro local: k não ganha; o limite ainda vale para lb
+                            d = before - drift[k];
+                            who = -1;
+                        } else {
+                            d = dist(kern, x, C.row(k), D);
+                            computed++;
+                            if (d < u || (d == u && k < a)) { a = k; u = d; }
+                        }
+                        if (d < m1[g]) { m2[g] = m1[g]; m1[g] = d; i1[g] = who; }
+                        else if (d < m2[g]) m2[g] = d;
+                    }
+                }
+
+                // Novos limites dos grupos visitados (excluindo o vencedor)
+                for (int g = 0; g < G; g++)
+                    if (seen[g]) lb[g] = (i1[g] == a) ? m2[g] : m1[g];
+                // O antigo dono passa a contar no limite do seu grupo
+                if (a0 >= 0 && a != a0 && !seen[group_of[a0]])
+                    lb[group_of[a0]] = std::min(lb[group_of[a0]], d0);
+                upper[i] = u;
+                if (a != a0) { upd.move(i, a0, a); labels[i] = a; changed++; }
+            }
+        }
+        res.dist_computed += computed;
+
+        it_scope.set(std::numeric_limits<double>::quiet_NaN(), changed);
+        if (changed == 0) {
+            res.iterations = iter;
+            res.converged = true;
+            break;
+        }
+
+        std::copy_n(C.data(), C.size(), old_c.data());
+        if (const long long applied = upd.update(X, N, labels, C); applied >= 0) {
+            res.delta_updates++;
+            res.moved += applied;
+        }
+        centroid_drift(kern, old_c, C, drift);
+        for (int g = 0; g < G; g++) {
+            gdrift[g] = 0.0;
+            for (int k : groups[g]) gdrift[g] = std::max(gdrift[g], drift[k]);
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < N; i++) {
+            double* lb = lower.row(i);
+            for (int g = 0; g < G; g++) lb[g] -= gdrift[g];
+            upper[i] += drift[labels[i]];
+        }
+    }
+    res.centroids = std::move(C);
+    return res;
+}
+
+// Escolhe a variante com poda pelo nome (--algo=hamerly|elkan|yinyang)
+inline KMeansResult kmeans_pruned(const std::string& algo, const Matrix<double>& X, int N,
+                                  Matrix<double> C, int max_iter, const DistanceKernel& kern,
+                                  bool delta = false) {
+    if (algo == "hamerly") return kmeans_hamerly(X, N, std::move(C), max_iter, kern, delta);
+    if (algo == "elkan") return kmeans_elkan(X, N, std::move(C), max_iter, kern, delta);
+    return kmeans_yinyang(X, N, std::move(C), max_iter, kern, delta);
+}
@@ -0,0 +1,104 @@
+// restarts.h
+#pragma once
+#include <bits/stdc++.h>
+#include "distance.h"
+#include "init.h"
+#include "kmeans_core.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// Vários reinícios (n_init) no mesmo processo, sobre o mesmo dataset.
+//
+// Os R reinícios (sementes seed, seed+1, ...) andam juntos, uma iteração de
+// Lloyd por vez cada um, e cada iteração usa o time inteiro de threads (a
+// passada fundida de CentroidSums). Todos leem o mesmo buffer de dados, só
+// para leitura; cada reinício guarda apenas centróides e rótulos.
+//
+// Corte antecipado: a inércia do Lloyd nunca sobe, então depois de
+// RESTART_WARMUP iterações um reinício cuja inércia passa a melhor atual
+// (reinícios vivos ou já convergidos) por mais de RESTART_MARGIN é abandonado.
+// A melhor corrida nunca é cortada; um reinício sem corte dá exatamente o
+// resultado de kmeans_lloyd com a mesma semente.
+// -----------------------------------------------------------------------------
+
+#define RESTART_WARMUP 5      // iterações antes de poder cortar
+#define RESTART_MARGIN 0.05   // corta acima de (1 + margem) × melhor inércia
+
+struct RestartRun {
+    uint64_t seed = 0;
+    int iterations = 0;       // mesmo significado de KMeansResult
+    bool converged = false;
+    int cut_at = -1;          // iteração do corte (-1 = foi até o fim)
+    double inertia = 0.0;     // final (ou no momento do corte)
+};
+
+struct MultiRestartResult {
+    KMeansResult best;              // modelo do melhor reinício
+    int best_index = -1;
+    std::vector<RestartRun> runs;
+};
+
+// -----------------------------------------------------------------------------
+// kmeans_restarts: R reinícios de Lloyd com a inicialização `init`.
+// -----------------------------------------------------------------------------
+inline MultiRestartResult kmeans_restarts(const Matrix<double>& X, int N, int K, int R, int max_iter,
+                                          const DistanceKernel& kern, const std::string& init,
+                                          uint64_t seed) {
+    const int D = static_cast<int>(X.cols());
+    MultiRestartResult res;
+    res.runs.resize(R);
+    std::vector<Matrix<double>> C(R);
+    std::vector<std::vector<int>> labels(R, std::vector<int>(N, -1));
+    std::vector<char> active(R, 1);
+    for (int r = 0; r < R; r++) {
+        res.runs[r].seed = seed + r;
+        C[r] = init_centroids(init, X, N, K, kern, seed + r);
+    }
+
+    CentroidSums acc(K, D);   // reaproveitada: os reinícios passam um de cada vez
+    for (int iter = 0; iter < max_iter; iter++) {
+        bool any = false;
+        for (int r = 0; r < R; r++) {
+            if (!active[r]) continue;
+            RestartRun& run = res.runs[r];
+            run.iterations = iter + 1;
+            acc.clear();
+            if (acc.assign_add(X, N, C[r], kern, labels[r].data(), &run.inertia) == 0) {
+                run.iterations = iter;
+                run.converged = true;
+                active[r] = 0;
+                continue;
+            }
+            acc.apply(C[r]);
+            any = true;
+        }
+        if (!any) break;
+
+        // Corte: compara com a melhor inércia entre os que não foram cortados
+        if (iter + 1 < RESTART_WARMUP) continue;
+        double best = std::numeric_limits<double>::infinity();
+        for (const RestartRun& run : res.runs)
+            if (run.cut_at < 0) best = std::min(best, run.inertia);
+        for (int r = 0; r < R; r++) {
+            if (active[r] && res.runs[r].inertia > (1.0 + RESTART_MARGIN) * best) {
+                res.runs[r].cut_at = iter + 1;
+                active[r] = 0;
+            }
+        }
+    }
+
+    // Inércia exata dos sobreviventes (os que pararam por max_iter ainda
+    // tinham a da atribuição anterior) e escolha do melhor
+    for (int r = 0; r < R; r++) {
+        RestartRun& run = res.runs[r];
+        if (run.cut_at >= 0) continue;
+        run.inertia = inertia(X, N, labels[r], C[r], kern);
+        if (res.best_index < 0 || run.inertia < res.runs[res.best_index].inertia) res.best_index = r;
+    }
+    const int b = res.best_index;
+    res.best.centroids = std::move(C[b]);
+    res.best.labels = std::move(labels[b]);
+    res.best.iterations = res.runs[b].iterations;
+    res.best.converged = res.runs[b].converged;
+    return res;
+}
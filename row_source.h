@@ -0,0 +1,193 @@
+// row_source.h
+#pragma once
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "csv_loader.h"
+#include "dataset.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// RowSource: acesso às linhas de um CSV ou .kmb sem carregar o arquivo.
+// O arquivo é só mapeado (mmap): as páginas ficam no cache do sistema e podem
+// ser descartadas, então a memória do processo depende só dos blocos que o
+// chamador pede (B×D), nunca de N.
+//
+//  - sample(): B linhas aleatórias. No .kmb sorteia o índice da linha; no CSV
+//    sorteia um byte e usa a linha seguinte (sem índice de linhas em memória).
+//  - read_block(): próximas linhas em ordem, para varrer o arquivo inteiro.
+// -----------------------------------------------------------------------------
+class RowSource {
+public:
+    RowSource(const std::string& filename, bool skip_header) : filename_(filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Erro ao abrir arquivo: " << filename << std::endl;
+            exit(1);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        size_ = static_cast<size_t>(st.st_size);
+        map_ = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (map_ == MAP_FAILED) {
+            std::cerr << "Erro no mmap de " << filename << std::endl;
+            exit(1);
+        }
+        base_ = static_cast<const char*>(map_);
+        end_ = base_ + size_;
+        if (is_kmb_file(filename)) open_kmb();
+        else open_csv(skip_header);
+    }
+    RowSource(const RowSource&) = delete;
+    RowSource& operator=(const RowSource&) = delete;
+    ~RowSource() { munmap(map_, size_); }
+
+    int dim() const { return D_; }
+    bool binary() const { return kmb_ != nullptr; }
+    // Número de linhas, conhecido só no .kmb (-1 no CSV)
+    long long rows() const { return kmb_ ? static_cast<long long>(kmb_->n) : -1; }
+
+    // Preenche as B primeiras linhas de out (B×D) com linhas sorteadas
+    void sample(std::mt19937_64& rng, int B, Matrix<double>& out) {
+        madvise(map_, size_, MADV_RANDOM);
+        std::vector<uint64_t> pos(B);
+        if (kmb_) {
+            std::uniform_int_distribution<uint64_t> pick(0, kmb_->n - 1);
+            for (int j = 0; j < B; j++) pos[j] = pick(rng);
+        } else {
+            std::uniform_int_distribution<uint64_t> pick(0, end_ - first_ - 1);
+            for (int j = 0; j < B; j++) pos[j] = pick(rng);
+        }
+        std::vector<char> ok(B, 1);
+        #pragma omp parallel for schedule(static)
+        for (int j = 0; j < B; j++) {
+            if (kmb_) std::copy_n(kmb_row(pos[j]), D_, out.row(j));
+            else ok[j] = csv_row_after(first_ + pos[j], out.row(j));
+        }
+        // Linhas malformadas ou em branco (raras) são sorteadas de novo
+        if (!kmb_) {
+            std::uniform_int_distribution<uint64_t> pick(0, end_ - first_ - 1);
+            for (int j = 0; j < B; j++)
+                while (!ok[j]) ok[j] = csv_row_after(first_ + pick(rng), out.row(j));
+        }
+    }
+
+    // Volta ao início para read_block
+    void rewind() {
+        cursor_ = 0;
+        madvise(map_, size_, MADV_SEQUENTIAL);
+    }
+
+    // Lê até B linhas seguintes para out; retorna quantas (0 no fim do arquivo)
+    int read_block(int B, Matrix<double>& out) {
+        int n = 0;
+        if (kmb_) {
+            while (n < B && cursor_ < kmb_->n) std::copy_n(kmb_row(cursor_++), D_, out.row(n++));
+            return n;
+        }
+        const char* p = first_ + cursor_;
+        while (n < B && p < end_) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end_ - p));
+            const char* le = nl ? nl : end_;
+            const char* te = csv_detail::trim_line_end(p, le);
+            if (te > p && csv_detail::parse_line(p, te, out.row(n), D_) == D_ + 1) n++;
+            p = le + 1;
+        }
+        cursor_ = static_cast<uint64_t>(std::min(p, end_) - first_);
+        return n;
+    }
+
+    // Número de linhas válidas (no CSV exige uma varredura; não mexe no cursor)
+    long long count_rows() {
+        if (kmb_) return static_cast<long long>(kmb_->n);
+        const uint64_t saved = cursor_;
+        Matrix<double> tmp(4096, D_);
+        long long n = 0;
+        rewind();
+        for (int got; (got = read_block(4096, tmp)) > 0; ) n += got;
+        cursor_ = saved;
+        return n;
+    }
+
+    // Copia as linhas de índices idx (na ordem de idx) para out
+    void gather(const std::vector<int>& idx, Matrix<double>& out) {
+        if (kmb_) {
+            for (size_t j = 0; j < idx.size(); j++) std::copy_n(kmb_row(idx[j]), D_, out.row(j));
+            return;
+        }
+        // CSV: uma varredura em ordem, copiando as linhas pedidas
+        std::vector<std::pair<int, size_t>> want;
+        for (size_t j = 0; j < idx.size(); j++) want.push_back({idx[j], j});
+        std::sort(want.begin(), want.end());
+        const uint64_t saved = cursor_;
+        Matrix<double> tmp(4096, D_);
+        long long base = 0;
+        size_t w = 0;
+        rewind();
+        for (int got; w < want.size() && (got = read_block(4096, tmp)) > 0; base += got)
+            for (; w < want.size() && want[w].first < base + got; w++)
+                std::copy_n(tmp.row(want[w].first - base), D_, out.row(want[w].second));
+        cursor_ = saved;
+    }
+
+private:
+    void open_kmb() {
+        const KmbHeader* h = static_cast<const KmbHeader*>(map_);
+        if (size_ < sizeof(KmbHeader) || !kmb_header_valid(*h, size_)) {
+            std::cerr << "Arquivo binário inválido ou incompatível: " << filename_ << std::endl;
+            exit(1);
+        }
+        kmb_ = h;
+        D_ = static_cast<int>(h->d);
+    }
+
+    void open_csv(bool skip_header) {
+        using namespace csv_detail;
+        const char* p = base_;
+        if (skip_header) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end_ - p));
+            p = nl ? nl + 1 : end_;
+        }
+        first_ = p;
+        // D vem da primeira linha com conteúdo (última coluna é o rótulo)
+        while (p < end_) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end_ - p));
+            const char* te = trim_line_end(p, nl ? nl : end_);
+            int n = te > p ? parse_line(p, te, nullptr, 0) : 0;
+            if (n > 1) { D_ = n - 1; return; }
+            p = nl ? nl + 1 : end_;
+        }
+        std::cerr << "Nenhuma amostra em " << filename_ << std::endl;
+        exit(1);
+    }
+
+    const double* kmb_row(uint64_t i) const {
+        return reinterpret_cast<const double*>(base_ + kmb_->data_offset) + i * kmb_->stride;
+    }
+
+    // Converte a primeira linha que começa depois de q (volta ao início do
+    // arquivo se q cair na última linha)
+    bool csv_row_after(const char* q, double* out) const {
+        if (q > first_) {
+            const char* nl = static_cast<const char*>(memchr(q - 1, '\n', end_ - (q - 1)));
+            q = nl ? nl + 1 : end_;
+        }
+        if (q >= end_) q = first_;
+        const char* nl = static_cast<const char*>(memchr(q, '\n', end_ - q));
+        const char* te = csv_detail::trim_line_end(q, nl ? nl : end_);
+        return te > q && csv_detail::parse_line(q, te, out, D_) == D_ + 1;
+    }
+
+    std::string filename_;
+    void* map_ = nullptr;
+    size_t size_ = 0;
+    const char* base_ = nullptr;
+    const char* end_ = nullptr;
+    const char* first_ = nullptr;       // primeira linha de dados (CSV)
+    const KmbHeader* kmb_ = nullptr;    // cabeçalho, se for .kmb
+    int D_ = 0;
+    uint64_t cursor_ = 0;               // linha (.kmb) ou byte (CSV) do read_block
+};
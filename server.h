@@ -0,0 +1,568 @@
+// server.h
+#pragma once
+#include <bits/stdc++.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "dataset.h"
+#include "distance.h"
+#include "init.h"
+#include "kmeans_core.h"
+#include "options.h"
+#include "pruned.h"
+#include "topology.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Modo servidor: `serve <arquivo> [<arquivo> ...] [--socket=caminho] [--jobs=J]`.
+//
+// Os datasets são carregados uma vez na partida e ficam em memória. J threads
+// trabalhadoras (padrão 1) tiram jobs de uma fila e cada uma mantém o próprio
+// time OpenMP (omp_get_max_threads()/J threads, aquecido na partida) e as
+// próprias somas de centróides e rótulos, reaproveitadas entre jobs de mesmo
+// K e D. Com J = 1 os jobs rodam um atrás do outro com todas as threads; com
+// J > 1 rodam ao mesmo tempo, cada um com a sua fatia.
+//
+// Protocolo: uma linha JSON plana por pedido, uma linha JSON por resposta.
+//   {"id": 7, "data": "covtype.kmb", "k": 10, "max_iter": 150, "seed": 1234,
+//    "init": "kmeans++", "algo": "lloyd", "update": "full", "centroids": false}
+//   {"cmd": "stats"}      latências acumuladas
+//   {"cmd": "shutdown"}   termina depois de esvaziar a fila
+// Só k é obrigatório; data é o nome (ou índice) de um arquivo da partida e
+// vale o primeiro se ausente. A resposta repete o id e traz iterações,
+// inércia, tamanhos dos clusters (e os centróides, se pedidos), o tempo de
+// fila (chegada até o início) e o de serviço (início até o fim), em ms.
+//
+// Sem --socket os pedidos vêm da entrada padrão e as respostas vão para a
+// saída padrão (linhas que começam com '{'; o resto é log). Com --socket o
+// servidor ouve num socket Unix e cada conexão recebe as respostas dos seus
+// pedidos, na ordem em que terminam.
+// -----------------------------------------------------------------------------
+
+#define SERVER_BACKLOG 16   // conexões pendentes no listen()
+
+namespace server_detail {
+
+using Clock = std::chrono::steady_clock;
+
+struct JsonValue {
+    std::string text;
+    bool quoted = false;   // veio entre aspas
+};
+using JsonObject = std::map<std::string, JsonValue>;
+
+// Objeto JSON plano: valores string, número, true/false/null (sem aninhar)
+inline bool parse_flat_json(const std::string& s, JsonObject& out, std::string& err) {
+    size_t p = 0;
+    auto ws = [&] { while (p < s.size() && isspace(static_cast<unsigned char>(s[p]))) p++; };
+    // Os 4 dígitos hexadecimais de um escape de código Unicode
+    auto hex4 = [&](unsigned& u) {
+        if (p + 4 > s.size()) return false;
+        u = 0;
+        for (int i = 0; i < 4; i++) {
+            const char c = s[p++];
+            u <<= 4;
+            if (c >= '0' && c <= '9') u |= c - '0';
+            else if (c >= 'a' && c <= 'f') u |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') u |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    };
+    // String entre aspas com os escapes do JSON decodificados (códigos Unicode em UTF-8)
+    auto str = [&](std::string& v) {
+        if (p >= s.size() || s[p] != '"') return false;
+        for (p++; p < s.size() && s[p] != '"'; ) {
+            if (s[p] != '\\') { v += s[p++]; continue; }
+            if (++p >= s.size()) return false;
+            const char e = s[p++];
+            switch (e) {
+            case '"': case '\\': case '/': v += e; break;
+            case 'b': v += '\b'; break;
+            case 'f': v += '\f'; break;
+            case 'n': v += '\n'; break;
+            case 'r': v += '\r'; break;
+            case 't': v += '\t'; break;
+            case 'u': {
+                unsigned u, lo;
+                if (!hex4(u)) return false;
+                if (u >= 0xD800 && u < 0xDC00) {   // par substituto
+                    if (p + 2 > s.size() || s[p] != '\\' || s[p + 1] != 'u') return false;
+                    p += 2;
+                    if (!hex4(lo) || lo < 0xDC00 || lo >= 0xE000) return false;
+                    u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+                } else if (u >= 0xDC00 && u < 0xE000) {
+                    return false;
+                }
+                if (u < 0x80) {
+                    v += static_cast<char>(u);
+                } else if (u < 0x800) {
+                    v += static_cast<char>(0xC0 | (u >> 6));
+                    v += static_cast<char>(0x80 | (u & 0x3F));
+                } else if (u < 0x10000) {
+                    v += static_cast<char>(0xE0 | (u >> 12));
+                    v += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                    v += static_cast<char>(0x80 | (u & 0x3F));
+                } else {
+                    v += static_cast<char>(0xF0 | (u >> 18));
+                    v += static_cast<char>(0x80 | ((u >> 12) & 0x3F));
+                    v += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+                    v += static_cast<char>(0x80 | (u & 0x3F));
+                }
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (p >= s.size()) return false;
+        p++;
+        return true;
+    };
+    // Literal sem aspas: número do JSON ou true/false/null
+    auto literal = [](const std::string& t) {
+        if (t == "true" || t == "false" || t == "null") return true;
+        size_t i = 0;
+        auto digits = [&] {
+            const size_t i0 = i;
+            while (i < t.size() && isdigit(static_cast<unsigned char>(t[i]))) i++;
+            return i > i0;
+        };
+        if (i < t.size() && t[i] == '-') i++;
+        if (i < t.size() && t[i] == '0') i++;
+        else if (!digits()) return false;
+        if (i < t.size() && t[i] == '.') {
+            i++;
+            if (!digits()) return false;
+        }
+        if (i < t.size() && (t[i] == 'e' || t[i] == 'E')) {
+            i++;
+            if (i < t.size() && (t[i] == '+' || t[i] == '-')) i++;
+            if (!digits()) return false;
+        }
+        return i == t.size();
+    };
+    ws();
+    if (p >= s.size() || s[p++] != '{') { err = "esperava '{'"; return false; }
+    ws();
+    if (p < s.size() && s[p] == '}') return true;
+    while (true) {
+        ws();
+        std::string key;
+        if (!str(key)) { err = "chave inválida"; return false; }
+        ws();
+        if (p >= s.size() || s[p++] != ':') { err = "esperava ':' depois de " + key; return false; }
+        ws();
+        JsonValue v;
+        if (p < s.size() && s[p] == '"') {
+            if (!str(v.text)) { err = "string sem fim ou escape inválido em " + key; return false; }
+            v.quoted = true;
+        } else {
+            while (p < s.size() && s[p] != ',' && s[p] != '}' && !isspace(static_cast<unsigned char>(s[p])))
+                v.text += s[p++];
+            if (!literal(v.text)) {
+                err = "valor inválido em " + key;
+                return false;
+            }
+        }
+        out[key] = v;
+        ws();
+        if (p < s.size() && s[p] == ',') { p++; continue; }
+        if (p < s.size() && s[p] == '}') return true;
+        err = "esperava ',' ou '}'";
+        return false;
+    }
+}
+
+inline std::string json_escape(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        if (c == '\r') { out += "\\r"; continue; }
+        if (c == '\t') { out += "\\t"; continue; }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            char u[8];
+            snprintf(u, sizeof(u), "\\u%04x", static_cast<unsigned char>(c));
+            out += u;
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+inline double ms(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+// Destino das respostas: a saída padrão ou uma conexão do socket
+struct Conn {
+    int fd;
+    bool socket;
+    std::mutex m;
+    Conn(int fd, bool socket) : fd(fd), socket(socket) {}
+    ~Conn() { if (socket) close(fd); }
+
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lk(m);
+        const std::string s = line + "\n";
+        size_t off = 0;
+        while (off < s.size()) {
+            const ssize_t w = socket ? ::send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL)
+                                     : ::write(fd, s.data() + off, s.size() - off);
+            if (w <= 0) return;   // cliente foi embora: a resposta se perde
+            off += static_cast<size_t>(w);
+        }
+    }
+};
+
+struct Job {
+    std::string id = "null";   // já em JSON
+    int data = 0;
+    int K = 0, max_iter = 0;
+    uint64_t seed = 1234;
+    std::string init = "random", algo = "lloyd";
+    bool delta = false, centroids = false;
+    Clock::time_point queued;
+    std::shared_ptr<Conn> conn;
+};
+
+// Buffers de uma thread trabalhadora, reaproveitados entre jobs
+struct Workspace {
+    int K = 0, D = 0;
+    std::optional<CentroidSums> acc;
+    std::vector<int> labels;
+};
+
+// Média, p95 e máximo de uma lista de latências
+inline std::string latency_json(std::vector<double> v) {
+    std::ostringstream os;
+    os << std::setprecision(6);
+    if (v.empty()) return "{\"mean\": 0, \"p95\": 0, \"max\": 0}";
+    std::sort(v.begin(), v.end());
+    const double mean = std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+    os << "{\"mean\": " << mean << ", \"p95\": " << v[(v.size() * 95 + 99) / 100 - 1] << ", \"max\": " << v.back() << "}";
+    return os.str();
+}
+
+}  // namespace server_detail
+
+// -----------------------------------------------------------------------------
+// KMeansServer: fila de jobs e threads trabalhadoras
+// -----------------------------------------------------------------------------
+class KMeansServer {
+public:
+    KMeansServer(std::vector<std::string> names, std::vector<Dataset>& data, int jobs, int default_k,
+                 int default_max_iter)
+        : names_(std::move(names)), data_(data), default_k_(default_k), default_max_iter_(default_max_iter) {
+        for (const Dataset& ds : data_) kern_.push_back(select_kernel(ds.D));
+        int T = topo_detail::num_threads();
+        threads_per_job_ = std::max(1, T / jobs);
+        for (int w = 0; w < jobs; w++) workers_.emplace_back([this] { work(); });
+    }
+
+    ~KMeansServer() { close(); }
+
+    int threads_per_job() const { return threads_per_job_; }
+
+    // Trata uma linha do protocolo; devolve false em {"cmd": "shutdown"}
+    bool handle(const std::string& line, const std::shared_ptr<server_detail::Conn>& conn) {
+        using namespace server_detail;
+        JsonObject obj;
+        std::string err;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) return true;
+        if (!parse_flat_json(line, obj, err)) {
+            conn->send("{\"id\": null, \"ok\": false, \"error\": " + json_escape("JSON inválido: " + err) + "}");
+            return true;
+        }
+        Job job;
+        if (obj.count("id")) job.id = obj["id"].quoted ? json_escape(obj["id"].text) : obj["id"].text;
+        if (obj.count("cmd")) {
+            const std::string cmd = obj["cmd"].text;
+            if (cmd == "shutdown") return false;
+            if (cmd == "stats") conn->send(stats_json(job.id));
+            else conn->send("{\"id\": " + job.id + ", \"ok\": false, \"error\": "
+                            + json_escape("comando desconhecido: " + cmd) + "}");
+            return true;
+        }
+        if (!make_job(obj, job, err)) {
+            conn->send("{\"id\": " + job.id + ", \"ok\": false, \"error\": " + json_escape(err) + "}");
+            return true;
+        }
+        job.conn = conn;
+        job.queued = Clock::now();
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            queue_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    // Para de aceitar jobs, esvazia a fila e espera as trabalhadoras
+    void close() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (closed_) return;
+            closed_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    std::string stats_json(const std::string& id = "null") {
+        std::lock_guard<std::mutex> lk(m_);
+        return "{\"id\": " + id + ", \"ok\": true, \"jobs\": " + std::to_string(queue_ms_.size())
+             + ", \"pending\": " + std::to_string(queue_.size())
+             + ", \"queue_ms\": " + server_detail::latency_json(queue_ms_)
+             + ", \"service_ms\": " + server_detail::latency_json(service_ms_) + "}";
+    }
+
+private:
+    bool make_job(server_detail::JsonObject& obj, server_detail::Job& job, std::string& err) {
+        try {
+            if (obj.count("data")) {
+                const std::string d = obj["data"].text;
+                auto it = std::find(names_.begin(), names_.end(), d);
+                if (it != names_.end()) job.data = static_cast<int>(it - names_.begin());
+                else if (!obj["data"].quoted) job.data = std::stoi(d);
+                else { err = "dataset não carregado: " + d; return false; }
+                if (job.data < 0 || job.data >= (int)data_.size()) { err = "dataset inválido: " + d; return false; }
+            }
+            const int N = data_[job.data].N;
+            job.K = obj.count("k") ? std::stoi(obj["k"].text) : default_k_;
+            job.max_iter = obj.count("max_iter") ? std::stoi(obj["max_iter"].text) : default_max_iter_;
+            if (obj.count("seed")) job.seed = std::stoull(obj["seed"].text);
+            if (obj.count("init")) job.init = obj["init"].text;
+            if (obj.count("algo")) job.algo = obj["algo"].text;
+            job.delta = obj.count("update") && obj["update"].text == "delta";
+            job.centroids = obj.count("centroids") && obj["centroids"].text == "true";
+            if (job.K <= 0 || job.K > N) { err = "K inválido: " + std::to_string(job.K); return false; }
+            if (job.max_iter < 0) { err = "max_iter inválido"; return false; }
+        } catch (const std::exception&) {
+            err = "número inválido";
+            return false;
+        }
+        if (job.init != "random" && job.init != "kmeans++" && job.init != "kmeans||") {
+            err = "inicialização inválida: " + job.init;
+            return false;
+        }
+        if (job.algo != "lloyd" && job.algo != "hamerly" && job.algo != "elkan" && job.algo != "yinyang") {
+            err = "algoritmo inválido: " + job.algo;
+            return false;
+        }
+        return true;
+    }
+
+    void work() {
+        using namespace server_detail;
+        // Herdaria a CPU única da thread principal fixada por bind_threads
+        unbind_this_thread();
+#ifdef _OPENMP
+        omp_set_num_threads(threads_per_job_);   // vale só para esta thread
+#endif
+        // Cria o time OpenMP desta trabalhadora antes do primeiro job
+        #pragma omp parallel
+        { }
+        Workspace ws;
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_.wait(lk, [&] { return closed_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            const Clock::time_point start = Clock::now();
+            std::string reply = run(job, ws);
+            const Clock::time_point end = Clock::now();
+            const double q = ms(start - job.queued), s = ms(end - start);
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                queue_ms_.push_back(q);
+                service_ms_.push_back(s);
+            }
+            std::ostringstream os;
+            os << std::setprecision(6) << ", \"queue_ms\": " << q << ", \"service_ms\": " << s << "}";
+            job.conn->send(reply + os.str());
+        }
+    }
+
+    // Roda um job; devolve a resposta sem o '}' final (as latências vêm depois)
+    std::string run(const server_detail::Job& job, server_detail::Workspace& ws) {
+        const Dataset& ds = data_[job.data];
+        const DistanceKernel& kern = kern_[job.data];
+        const int N = ds.N, D = ds.D, K = job.K;
+        Matrix<double> C = init_centroids(job.init, ds.X, N, K, kern, job.seed);
+        KMeansResult res;
+        if (job.algo != "lloyd") {
+            res = kmeans_pruned(job.algo, ds.X, N, std::move(C), job.max_iter, kern, job.delta);
+        } else if (job.delta) {
+            res = kmeans_lloyd(ds.X, N, std::move(C), job.max_iter, kern, nullptr, true);
+        } else {
+            // Lloyd com a passada fundida, sobre as somas e rótulos desta trabalhadora
+            if (!ws.acc || ws.K != K || ws.D != D) {
+                ws.acc.emplace(K, D);
+                ws.K = K;
+                ws.D = D;
+            }
+            ws.labels.assign(N, -1);
+            for (int iter = 0; iter < job.max_iter; iter++) {
+                res.iterations = iter + 1;
+                ws.acc->clear();
+                if (ws.acc->assign_add(ds.X, N, C, kern, ws.labels.data()) == 0) {
+                    res.iterations = iter;
+                    res.converged = true;
+                    break;
+                }
+                ws.acc->apply(C);
+            }
+            res.centroids = std::move(C);
+            res.labels = ws.labels;
+        }
+
+        std::vector<long long> size(K, 0);
+        for (int l : res.labels) if (l >= 0) size[l]++;
+        std::ostringstream os;
+        os << std::setprecision(10);
+        os << "{\"id\": " << job.id << ", \"ok\": true, \"data\": " << server_detail::json_escape(names_[job.data])
+           << ", \"k\": " << K << ", \"iterations\": " << res.iterations
+           << ", \"converged\": " << (res.converged ? "true" : "false")
+           << ", \"inertia\": " << inertia(ds.X, N, res.labels, res.centroids, kern) << ", \"sizes\": [";
+        for (int k = 0; k < K; k++) os << (k ? ", " : "") << size[k];
+        os << "]";
+        if (job.centroids) {
+            os << ", \"centroids\": [";
+            for (int k = 0; k < K; k++) {
+                os << (k ? ", [" : "[");
+                for (int d = 0; d < D; d++) os << (d ? ", " : "") << res.centroids(k, d);
+                os << "]";
+            }
+            os << "]";
+        }
+        return os.str();
+    }
+
+    std::vector<std::string> names_;
+    std::vector<Dataset>& data_;
+    std::vector<DistanceKernel> kern_;
+    int default_k_, default_max_iter_;
+    int threads_per_job_ = 1;
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<server_detail::Job> queue_;
+    bool closed_ = false;
+    std::vector<double> queue_ms_, service_ms_;
+    std::vector<std::thread> workers_;
+};
+
+// -----------------------------------------------------------------------------
+// serve_main: carrega os datasets e atende pela entrada padrão ou pelo socket
+// -----------------------------------------------------------------------------
+inline int serve_main(const Options& opt, bool skip_header, bool verify, int default_k, int default_max_iter) {
+    using namespace server_detail;
+    if (opt.args.size() < 2) {
+        std::cerr << "Uso: serve <arquivo> [<arquivo> ...] [--socket=caminho] [--jobs=J]" << std::endl;
+        return 1;
+    }
+    const int jobs = opt.get_int("jobs", 1);
+    if (jobs < 1) {
+        std::cerr << "--jobs inválido: " << jobs << std::endl;
+        return 1;
+    }
+    std::vector<std::string> names(opt.args.begin() + 1, opt.args.end());
+    std::vector<Dataset> data;
+    for (const std::string& f : names) {
+        const Clock::time_point t0 = Clock::now();
+        data.push_back(load_dataset(f, skip_header, verify));
+        if (data.back().N == 0) {
+            std::cerr << "Nenhuma amostra carregada de " << f << std::endl;
+            return 1;
+        }
+        std::cerr << "→ Carreguei " << data.back().N << " amostras de " << f << " (dim=" << data.back().D
+                  << ") em " << ms(Clock::now() - t0) << " ms" << std::endl;
+    }
+
+    KMeansServer server(names, data, jobs, default_k, default_max_iter);
+    std::cerr << "→ Servidor: " << jobs << " job(s) simultâneo(s), " << server.threads_per_job()
+              << " thread(s) cada" << std::endl;
+
+    if (!opt.has("socket")) {
+        auto out = std::make_shared<Conn>(STDOUT_FILENO, false);
+        std::string line;
+        while (std::getline(std::cin, line) && server.handle(line, out)) { }
+    } else {
+        const std::string path = opt.get("socket", "kmeans.sock");
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Caminho do socket longo demais: " << path << std::endl;
+            return 1;
+        }
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        const int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if (lfd < 0 || bind(lfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || listen(lfd, SERVER_BACKLOG) != 0) {
+            std::cerr << "Erro ao abrir o socket " << path << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        std::cerr << "→ Ouvindo em " << path << std::endl;
+
+        // Conexões abertas: cada leitora sai do registro quando o cliente
+        // desconecta (o fd fecha quando a última resposta pendente sai)
+        std::atomic<bool> stop{false};
+        std::mutex cm;
+        std::condition_variable ccv;
+        std::map<Conn*, std::shared_ptr<Conn>> clients;
+        while (!stop) {
+            const int fd = accept(lfd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR && !stop) continue;
+                break;
+            }
+            auto conn = std::make_shared<Conn>(fd, true);
+            {
+                std::lock_guard<std::mutex> lk(cm);
+                clients[conn.get()] = conn;
+            }
+            std::thread([&server, &stop, &cm, &ccv, &clients, conn, lfd] {
+                std::string buf;
+                char chunk[4096];
+                bool open = true;
+                while (open) {
+                    const ssize_t r = recv(conn->fd, chunk, sizeof(chunk), 0);
+                    if (r <= 0) break;
+                    buf.append(chunk, static_cast<size_t>(r));
+                    size_t nl;
+                    while (open && (nl = buf.find('\n')) != std::string::npos) {
+                        const std::string line = buf.substr(0, nl);
+                        buf.erase(0, nl + 1);
+                        if (!server.handle(line, conn)) {
+                            stop = true;
+                            shutdown(lfd, SHUT_RDWR);   // acorda o accept()
+                            open = false;
+                        }
+                    }
+                }
+                std::lock_guard<std::mutex> lk(cm);
+                clients.erase(conn.get());
+                ccv.notify_all();
+            }).detach();
+        }
+        // Sem novos pedidos; as respostas pendentes ainda saem pelas conexões
+        {
+            std::unique_lock<std::mutex> lk(cm);
+            for (auto& c : clients) shutdown(c.first->fd, SHUT_RD);
+            ccv.wait(lk, [&] { return clients.empty(); });
+        }
+        close(lfd);
+        unlink(path.c_str());
+    }
+
+    server.close();
+    std::cerr << "→ Servidor encerrado: " << server.stats_json() << std::endl;
+    return 0;
+}
@@ -0,0 +1,49 @@
+// synthetic.h
+#pragma once
+#include <bits/stdc++.h>
+#include "dataset.h"
+#include "matrix.h"
+
+// -----------------------------------------------------------------------------
+// Gerador de dados sintéticos: K nuvens gaussianas em D dimensões.
+//
+// Os centros são sorteados no cubo [-BLOB_BOX, BLOB_BOX]^D e cada ponto é um
+// centro (escolhido ao acaso) mais ruído N(0, spread²) em cada coordenada. O
+// rótulo guardado é a nuvem de origem. Cada bloco de BLOB_BLOCK linhas tem o
+// próprio gerador (semente {seed, bloco}), então o arquivo sai igual para a
+// mesma semente, com qualquer número de threads.
+// -----------------------------------------------------------------------------
+
+#define BLOB_BOX   10.0   // meia aresta do cubo dos centros
+#define BLOB_BLOCK 4096   // linhas por gerador
+
+inline Dataset make_blobs(int N, int D, int K, uint64_t seed, double spread = 1.0) {
+    Dataset ds;
+    ds.N = N;
+    ds.D = D;
+    ds.X.reset(N, D);
+    ds.owned_labels.assign(N, 0.0);
+
+    Matrix<double> centers(K, D);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> box(-BLOB_BOX, BLOB_BOX);
+    for (int k = 0; k < K; k++)
+        for (int d = 0; d < D; d++) centers(k, d) = box(rng);
+
+    const int nb = (N + BLOB_BLOCK - 1) / BLOB_BLOCK;
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nb; b++) {
+        std::seed_seq ss{seed, static_cast<uint64_t>(b)};
+        std::mt19937_64 r(ss);
+        std::uniform_int_distribution<int> pick(0, K - 1);
+        std::normal_distribution<double> noise(0.0, spread);
+        for (int i = b * BLOB_BLOCK; i < std::min(N, (b + 1) * BLOB_BLOCK); i++) {
+            const int k = pick(r);
+            double* x = ds.X.row(i);
+            for (int d = 0; d < D; d++) x[d] = centers(k, d) + noise(r);
+            ds.owned_labels[i] = k;
+        }
+    }
+    ds.labels = ds.owned_labels.data();
+    return ds;
+}
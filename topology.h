@@ -0,0 +1,259 @@
+// topology.h
+#pragma once
+#include <bits/stdc++.h>
+#include <dirent.h>
+#include <sched.h>
+#include "matrix.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Topologia NUMA e posicionamento das threads OpenMP.
+//
+// Os nós e suas CPUs vêm de /sys/devices/system/node (sem libnuma); só contam
+// as CPUs permitidas ao processo (sched_getaffinity). Sem sysfs tudo vira um
+// nó só. bind_threads() reparte as threads entre os nós em faixas contíguas
+// (threads 0..n0-1 no nó 0, as seguintes no nó 1, ...) e fixa cada uma numa
+// CPU. first_touch_copy() grava cada bloco de linhas pela thread que vai
+// processá-lo, então as páginas dele ficam no nó dessa thread.
+// -----------------------------------------------------------------------------
+
+struct Topology {
+    std::vector<int> node_id;                  // número do nó no sysfs
+    std::vector<std::vector<int>> node_cpus;   // CPUs permitidas de cada nó
+    int nodes() const { return static_cast<int>(node_cpus.size()); }
+    int cpus() const {
+        int n = 0;
+        for (const auto& c : node_cpus) n += static_cast<int>(c.size());
+        return n;
+    }
+};
+
+// Onde cada thread ficou; nodes > 1 só quando as threads estão fixadas
+struct ThreadPlacement {
+    int nodes = 1;
+    std::string policy = "none";   // spread, close, none ou runtime (OMP_PROC_BIND)
+    std::vector<int> cpu;          // CPU de cada thread (-1 = não fixada)
+    std::vector<int> node;         // índice do nó de cada thread
+    std::vector<int> allowed;      // CPUs permitidas ao processo antes da fixação
+};
+
+// Posicionamento em vigor (preenchido por bind_threads, lido pelos núcleos)
+inline ThreadPlacement& thread_placement() {
+    static ThreadPlacement p;
+    return p;
+}
+
+namespace topo_detail {
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+inline std::vector<int> parse_cpulist(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || !isdigit(static_cast<unsigned char>(part[0]))) continue;
+        const size_t dash = part.find('-');
+        const int a = std::stoi(part.substr(0, dash));
+        const int b = dash == std::string::npos ? a : std::stoi(part.substr(dash + 1));
+        for (int c = a; c <= b; c++) out.push_back(c);
+    }
+    return out;
+}
+
+inline int num_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int thread_id() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+}  // namespace topo_detail
+
+// -----------------------------------------------------------------------------
+// read_topology: nós com pelo menos uma CPU permitida, em ordem crescente
+// -----------------------------------------------------------------------------
+inline Topology read_topology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) CPU_SET(c, &allowed);
+    }
+    Topology t;
+    std::vector<int> ids;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* e = readdir(dir)) {
+            if (strncmp(e->d_name, "node", 4) == 0 && isdigit(static_cast<unsigned char>(e->d_name[4])))
+                ids.push_back(atoi(e->d_name + 4));
+        }
+        closedir(dir);
+    }
+    std::sort(ids.begin(), ids.end());
+    for (int id : ids) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        std::string line;
+        std::getline(in, line);
+        std::vector<int> cpus;
+        for (int c : topo_detail::parse_cpulist(line))
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        if (cpus.empty()) continue;   // nó só de memória ou fora da afinidade
+        t.node_id.push_back(id);
+        t.node_cpus.push_back(std::move(cpus));
+    }
+    if (t.node_cpus.empty()) {
+        std::vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        t.node_id.push_back(0);
+        t.node_cpus.push_back(std::move(cpus));
+    }
+    return t;
+}
+
+// -----------------------------------------------------------------------------
+// bind_threads: fixa as threads do próximo time OpenMP.
+//  spread - faixas contíguas de threads, divididas por igual entre os nós
+//  close  - enche as CPUs do nó 0, depois as do nó 1, ...
+//  none   - não fixa (o sistema decide; sem réplicas por nó)
+// Se OMP_PROC_BIND estiver definido, o runtime manda: só anota onde cada
+// thread está.
+// -----------------------------------------------------------------------------
+inline const ThreadPlacement& bind_threads(const Topology& topo, const std::string& policy) {
+    ThreadPlacement& p = thread_placement();
+    const int T = topo_detail::num_threads();
+    const int nn = topo.nodes();
+    p = ThreadPlacement();
+    for (const auto& c : topo.node_cpus) p.allowed.insert(p.allowed.end(), c.begin(), c.end());
+    p.cpu.assign(T, -1);
+    p.node.assign(T, 0);
+    p.policy = getenv("OMP_PROC_BIND") ? "runtime" : policy;
+    if (p.policy == "none") return p;
+
+    if (p.policy == "runtime") {
+        // Descobre o nó de cada thread pela CPU em que ela roda
+        std::map<int, int> cpu_node;
+        for (int j = 0; j < nn; j++)
+            for (int c : topo.node_cpus[j]) cpu_node[c] = j;
+        #pragma omp parallel num_threads(T)
+        {
+            const int t = topo_detail::thread_id();
+            const int c = sched_getcpu();
+            p.cpu[t] = c;
+            p.node[t] = cpu_node.count(c) ? cpu_node[c] : 0;
+        }
+    } else {
+        std::vector<int> used(nn, 0);
+        int fill = 0;
+        for (int t = 0; t < T; t++) {
+            int j;
+            if (policy == "spread") {
+                j = static_cast<int>((long long)t * nn / T);
+            } else {
+                while (fill < nn - 1 && used[fill] >= (int)topo.node_cpus[fill].size()) fill++;
+                j = fill;
+            }
+            const std::vector<int>& cpus = topo.node_cpus[j];
+            p.node[t] = j;
+            p.cpu[t] = cpus[used[j]++ % cpus.size()];
+        }
+        #pragma omp parallel num_threads(T)
+        {
+            const int t = topo_detail::thread_id();
+            cpu_set_t s;
+            CPU_ZERO(&s);
+            CPU_SET(p.cpu[t], &s);
+            sched_setaffinity(0, sizeof(s), &s);   // 0 = a própria thread
+        }
+    }
+    p.nodes = *std::max_element(p.node.begin(), p.node.end()) + 1;
+    return p;
+}
+
+// Devolve a thread atual a todas as CPUs permitidas (threads auxiliares, como
+// a de E/S, herdam a fixação de quem as criou)
+inline void unbind_this_thread() {
+    const ThreadPlacement& p = thread_placement();
+    if (p.allowed.empty()) return;
+    cpu_set_t s;
+    CPU_ZERO(&s);
+    for (int c : p.allowed) CPU_SET(c, &s);
+    sched_setaffinity(0, sizeof(s), &s);
+}
+
+// Enquanto existir, restringe a thread atual às CPUs das threads [t0, t1) de
+// bind_threads (sem fixação, a todas as permitidas); um time OpenMP aninhado
+// criado por ela herda essa fatia. O destrutor devolve a máscara anterior.
+class ScopedCpuSlice {
+public:
+    ScopedCpuSlice(int t0, int t1) {
+        saved_ok_ = sched_getaffinity(0, sizeof(saved_), &saved_) == 0;
+        const ThreadPlacement& p = thread_placement();
+        cpu_set_t s;
+        CPU_ZERO(&s);
+        int n = 0;
+        for (int t = std::max(t0, 0); t < std::min<int>(t1, p.cpu.size()); t++)
+            if (p.cpu[t] >= 0) { CPU_SET(p.cpu[t], &s); n++; }
+        if (n == 0)
+            for (int c : p.allowed) { CPU_SET(c, &s); n++; }
+        if (n > 0) sched_setaffinity(0, sizeof(s), &s);
+    }
+    ScopedCpuSlice(const ScopedCpuSlice&) = delete;
+    ScopedCpuSlice& operator=(const ScopedCpuSlice&) = delete;
+    ~ScopedCpuSlice() { if (saved_ok_) sched_setaffinity(0, sizeof(saved_), &saved_); }
+
+private:
+    cpu_set_t saved_;
+    bool saved_ok_ = false;
+};
+
+// Relatório de uma linha por item: nós/CPUs e onde ficaram as threads
+inline void print_topology(std::ostream& os, const Topology& topo, const ThreadPlacement& p) {
+    os << "→ Topologia: " << topo.nodes() << " nó(s) NUMA, " << topo.cpus() << " CPUs permitidas (";
+    for (int j = 0; j < topo.nodes(); j++) {
+        const std::vector<int>& c = topo.node_cpus[j];
+        os << (j ? ", " : "") << "nó " << topo.node_id[j] << ": " << c.size() << " CPUs "
+           << c.front() << ".." << c.back();
+    }
+    os << ")" << std::endl;
+    os << "→ Threads: " << p.cpu.size() << ", fixação " << p.policy;
+    if (p.policy != "none") {
+        std::vector<int> per(topo.nodes(), 0);
+        for (int j : p.node) per[j]++;
+        os << " (";
+        for (int j = 0; j < topo.nodes(); j++) os << (j ? ", " : "") << per[j] << " no nó " << topo.node_id[j];
+        os << ")";
+    }
+    os << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// first_touch_copy: cópia de X em memória nova cujas páginas são tocadas
+// primeiro por quem vai usá-las. O bloco b de `block` linhas é gravado pela
+// thread b % T (mesmo mapeamento do schedule(static, 1) de CentroidSums).
+// -----------------------------------------------------------------------------
+template <typename T>
+Matrix<T> first_touch_copy(const Matrix<T>& X, int block) {
+    Matrix<T> out(X.rows(), X.cols(), false);
+    const long long n = static_cast<long long>(X.rows());
+    const long long nb = (n + block - 1) / block;
+    const size_t D = X.cols(), S = out.stride();
+    #pragma omp parallel for schedule(static, 1)
+    for (long long b = 0; b < nb; b++) {
+        for (long long i = b * block; i < std::min(n, (b + 1) * block); i++) {
+            T* dst = out.row(i);
+            std::copy_n(X.row(i), D, dst);
+            std::fill(dst + D, dst + S, T(0));   // padding continua zerado
+        }
+    }
+    return out;
+}